@@ -0,0 +1,112 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Hands objects from non-realtime code to a single realtime reader with an
+// atomic pointer swap. The reader never allocates or frees: objects it lets go
+// of are queued back and deleted by collectGarbage() on a non-realtime thread.
+//
+// publish() and collectGarbage() must be called from one non-realtime thread
+// at a time; exchangePending(), retire() and acquire() from the reader only.
+template <typename ObjectType, typename Deleter = std::default_delete<ObjectType>>
+class AtomicPublisher
+{
+public:
+    using Ptr = std::unique_ptr<ObjectType, Deleter>;
+
+    AtomicPublisher() = default;
+
+    ~AtomicPublisher()
+    {
+        collectGarbage();
+        destroy(pending.exchange(nullptr));
+        destroy(current);
+    }
+
+    //==============================================================================
+    // Publisher side. A newer object replaces one the reader has not picked up
+    // yet; the older one was never seen by the reader, so it is freed here.
+    void publish(Ptr object)
+    {
+        collectGarbage();
+        destroy(pending.exchange(object.release(), std::memory_order_acq_rel));
+    }
+
+    void collectGarbage()
+    {
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToRead(retiredFifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i)
+            destroy(retired[static_cast<size_t>(start1 + i)]);
+
+        for (int i = 0; i < size2; ++i)
+            destroy(retired[static_cast<size_t>(start2 + i)]);
+
+        retiredFifo.finishedRead(size1 + size2);
+    }
+
+    bool hasPending() const noexcept { return pending.load(std::memory_order_acquire) != nullptr; }
+
+    //==============================================================================
+    // Reader side, low level: take ownership of the latest published object
+    // (or nullptr) and hand objects back once nothing refers to them any more.
+    // retire() returns false if the queue is full; keep the object and retry.
+    ObjectType* exchangePending() noexcept
+    {
+        if (pending.load(std::memory_order_relaxed) == nullptr)
+            return nullptr;
+
+        return pending.exchange(nullptr, std::memory_order_acq_rel);
+    }
+
+    bool retire(ObjectType* object) noexcept
+    {
+        if (object == nullptr)
+            return true;
+
+        int start1, size1, start2, size2;
+        retiredFifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 == 0)
+            return false;
+
+        retired[static_cast<size_t>(start1)] = object;
+        retiredFifo.finishedWrite(1);
+        return true;
+    }
+
+    // Reader side, high level: adopt the latest object and retire the one it replaces
+    ObjectType* acquire() noexcept
+    {
+        if (pending.load(std::memory_order_relaxed) != nullptr && retiredFifo.getFreeSpace() > 0)
+        {
+            if (auto* next = exchangePending())
+            {
+                retire(current);
+                current = next;
+            }
+        }
+
+        return current;
+    }
+
+    ObjectType* getCurrent() const noexcept { return current; }
+
+private:
+    static void destroy(ObjectType* object)
+    {
+        if (object != nullptr)
+            Deleter()(object);
+    }
+
+    static constexpr int retiredCapacity = 16;
+
+    std::atomic<ObjectType*> pending { nullptr };
+    ObjectType* current = nullptr;
+
+    juce::AbstractFifo retiredFifo { retiredCapacity };
+    std::array<ObjectType*, retiredCapacity> retired {};
+
+    JUCE_DECLARE_NON_COPYABLE(AtomicPublisher)
+};
@@ -0,0 +1,276 @@
+#include <JuceHeader.h>
+#include "StemSeparator.h"
+#include "StemCache.h"
+
+// Headless batch separation: splits every audio file in a directory into
+// per-stem files using the same StemSeparator/Demucs code as the plugin.
+//
+//   StemSplitterBatch <input dir> <output dir> [--format=wav|flac] [--quality=0-3]
+//                     [--jobs=N] [--segment=samples] [--overlap=0-0.9] [--no-cache]
+//
+// Separated stems are kept in the shared StemCache, so files seen before (by
+// this tool or the plugin) are written out without running the model.
+
+namespace
+{
+    const char* const stemNames[] = { "drums", "bass", "other", "vocals" };
+
+    struct BatchSettings
+    {
+        juce::File inputDirectory;
+        juce::File outputDirectory;
+        bool useFlac = false;
+        int quality = 2;
+        int numJobs = 1;
+        int segmentLength = STEMSPLITTER_SEGMENT_LENGTH;
+        float segmentOverlap = STEMSPLITTER_SEGMENT_OVERLAP;
+        bool useCache = true;
+    };
+
+    struct BatchTotals
+    {
+        juce::CriticalSection lock;
+        double audioSeconds = 0.0;
+        int numSucceeded = 0;
+        int numFailed = 0;
+    };
+
+    void printLine(BatchTotals& totals, const juce::String& text)
+    {
+        const juce::ScopedLock sl(totals.lock);
+        std::cout << text << std::endl;
+    }
+
+    bool writeStem(const juce::File& file, const juce::AudioBuffer<float>& stem,
+                   double sampleRate, bool useFlac)
+    {
+        std::unique_ptr<juce::AudioFormat> format;
+
+        if (useFlac)
+            format = std::make_unique<juce::FlacAudioFormat>();
+        else
+            format = std::make_unique<juce::WavAudioFormat>();
+
+        file.deleteFile();
+        auto stream = file.createOutputStream();
+
+        if (stream == nullptr)
+            return false;
+
+        std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate,
+                                                                                static_cast<unsigned int>(stem.getNumChannels()),
+                                                                                24, {}, 0));
+
+        if (writer == nullptr)
+            return false;
+
+        // The writer owns the stream now
+        stream.release();
+        return writer->writeFromAudioSampleBuffer(stem, 0, stem.getNumSamples());
+    }
+
+    //==========================================================================
+    class SeparationJob : public juce::ThreadPoolJob
+    {
+    public:
+        SeparationJob(const juce::File& fileToSeparate, const juce::String& outputNameToUse,
+                      const BatchSettings& settingsToUse, BatchTotals& totalsToUse)
+            : juce::ThreadPoolJob(fileToSeparate.getFileName()),
+              file(fileToSeparate), outputName(outputNameToUse), settings(settingsToUse), totals(totalsToUse)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            if (separate())
+            {
+                const juce::ScopedLock sl(totals.lock);
+                ++totals.numSucceeded;
+            }
+            else
+            {
+                const juce::ScopedLock sl(totals.lock);
+                ++totals.numFailed;
+            }
+
+            return jobHasFinished;
+        }
+
+    private:
+        bool separate()
+        {
+            juce::AudioFormatManager formatManager;
+            formatManager.registerBasicFormats();
+
+            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+            if (reader == nullptr || reader->lengthInSamples > std::numeric_limits<int>::max())
+            {
+                printLine(totals, file.getFileName() + ": unreadable or too long, skipped");
+                return false;
+            }
+
+            const int numSamples = static_cast<int>(reader->lengthInSamples);
+            const double sampleRate = reader->sampleRate;
+
+            juce::AudioBuffer<float> input(static_cast<int>(reader->numChannels), numSamples);
+            reader->read(&input, 0, numSamples, 0, true, true);
+
+            StemSeparator separator;
+            separator.setModelQuality(settings.quality);
+            separator.setSegmentSettings(settings.segmentLength, settings.segmentOverlap);
+
+            std::array<juce::AudioBuffer<float>, 4> stems;
+            StemCache cache;
+            StemCache::EntryPtr cached;
+
+            const double startMs = juce::Time::getMillisecondCounterHiRes();
+            const auto key = StemCache::makeKey(input, separator.getModelIdentity(), sampleRate);
+
+            if (settings.useCache)
+                cached = cache.find(key);
+
+            if (cached == nullptr)
+            {
+                separator.separateOffline(input, juce::roundToInt(sampleRate), stems);
+
+                if (settings.useCache)
+                    cache.store(key, stems, sampleRate);
+            }
+
+            const double elapsedSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+            const auto& separated = cached != nullptr ? cached->getStems() : stems;
+
+            const auto extension = settings.useFlac ? ".flac" : ".wav";
+
+            for (int i = 0; i < 4; ++i)
+            {
+                const auto stemFile = settings.outputDirectory.getChildFile(outputName + "_" + stemNames[i] + extension);
+
+                if (!writeStem(stemFile, separated[static_cast<size_t>(i)], sampleRate, settings.useFlac))
+                {
+                    printLine(totals, file.getFileName() + ": failed to write " + stemFile.getFullPathName());
+                    return false;
+                }
+            }
+
+            const double audioSeconds = numSamples / sampleRate;
+
+            {
+                const juce::ScopedLock sl(totals.lock);
+                totals.audioSeconds += audioSeconds;
+            }
+
+            printLine(totals, file.getFileName()
+                              + ": " + juce::String(audioSeconds, 2) + " s audio in "
+                              + juce::String(elapsedSeconds, 2) + " s, realtime factor "
+                              + juce::String(audioSeconds / juce::jmax(1.0e-9, elapsedSeconds), 2) + "x"
+                              + (cached != nullptr ? " (cached)" : ""));
+            return true;
+        }
+
+        juce::File file;
+        juce::String outputName;
+        const BatchSettings& settings;
+        BatchTotals& totals;
+    };
+
+    int printUsage()
+    {
+        std::cout << "Usage: StemSplitterBatch <input dir> <output dir> [--format=wav|flac] [--quality=0-3]" << std::endl
+                  << "                         [--jobs=N] [--segment=samples] [--overlap=0-0.9] [--no-cache]" << std::endl;
+        return 1;
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+
+    if (args.size() < 2)
+        return printUsage();
+
+    BatchSettings settings;
+    settings.inputDirectory = args[0].resolveAsFile();
+    settings.outputDirectory = args[1].resolveAsFile();
+
+    if (args.containsOption("--format"))
+        settings.useFlac = args.getValueForOption("--format").equalsIgnoreCase("flac");
+
+    if (args.containsOption("--quality"))
+        settings.quality = juce::jlimit(0, 3, args.getValueForOption("--quality").getIntValue());
+
+    settings.numJobs = juce::SystemStats::getNumCpus();
+
+    if (args.containsOption("--jobs"))
+        settings.numJobs = juce::jmax(1, args.getValueForOption("--jobs").getIntValue());
+
+    if (args.containsOption("--segment"))
+        settings.segmentLength = args.getValueForOption("--segment").getIntValue();
+
+    if (args.containsOption("--overlap"))
+        settings.segmentOverlap = args.getValueForOption("--overlap").getFloatValue();
+
+    settings.useCache = !args.containsOption("--no-cache");
+
+    if (!settings.inputDirectory.isDirectory())
+    {
+        std::cout << "Input directory not found: " << settings.inputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    if (!settings.outputDirectory.createDirectory())
+    {
+        std::cout << "Cannot create output directory: " << settings.outputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    juce::AudioFormatManager formatManager;
+    formatManager.registerBasicFormats();
+
+    const auto files = settings.inputDirectory.findChildFiles(juce::File::findFiles, false,
+                                                              formatManager.getWildcardForAllFormats());
+
+    if (files.isEmpty())
+    {
+        std::cout << "No audio files in " << settings.inputDirectory.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    // One file per job; each job owns its separator, so files run fully in parallel
+    BatchTotals totals;
+    juce::ThreadPool pool(juce::jmin(settings.numJobs, files.size()));
+
+    const double startMs = juce::Time::getMillisecondCounterHiRes();
+
+    // Inputs that differ only in extension (song.wav, song.flac) would write
+    // the same stem files, so those keep their extension in the output name
+    std::map<juce::String, int> namesInUse;
+
+    for (const auto& file : files)
+        ++namesInUse[file.getFileNameWithoutExtension().toLowerCase()];
+
+    for (const auto& file : files)
+    {
+        auto outputName = file.getFileNameWithoutExtension();
+
+        if (namesInUse[outputName.toLowerCase()] > 1)
+            outputName << "_" << file.getFileExtension().substring(1);
+
+        pool.addJob(new SeparationJob(file, outputName, settings, totals), true);
+    }
+
+    while (pool.getNumJobs() > 0)
+        juce::Thread::sleep(50);
+
+    const double wallSeconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+
+    std::cout << "Separated " << totals.numSucceeded << " of " << files.size() << " files: "
+              << juce::String(totals.audioSeconds, 1) << " s audio in "
+              << juce::String(wallSeconds, 1) << " s, aggregate realtime factor "
+              << juce::String(totals.audioSeconds / juce::jmax(1.0e-9, wallSeconds), 2) << "x"
+              << " on " << pool.getNumThreads() << " threads" << std::endl;
+
+    return totals.numFailed == 0 ? 0 : 1;
+}
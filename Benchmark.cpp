@@ -0,0 +1,304 @@
+#include <JuceHeader.h>
+#include "DemucsInterface.h"
+#include "StemSeparator.h"
+#include "SamplerComponent.h"
+
+// Benchmarks for the separator and sampler hot paths. Prints one JSON document
+// with ns/sample and realtime factor for every configuration.
+//
+//   StemSplitterBenchmark [--quick] [--output=results.json]
+
+namespace
+{
+    struct Sweep
+    {
+        std::vector<int> blockSizes;
+        std::vector<int> voiceCounts;
+        std::vector<int> sampleRates;
+        double secondsPerCase = 1.0;
+    };
+
+    Sweep makeSweep(bool quick)
+    {
+        Sweep sweep;
+
+        if (quick)
+        {
+            sweep.blockSizes = { 32, 256, 2048, 8192 };
+            sweep.voiceCounts = { 1, 16, 64 };
+            sweep.sampleRates = { 48000 };
+            sweep.secondsPerCase = 0.25;
+        }
+        else
+        {
+            sweep.blockSizes = { 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+            sweep.voiceCounts = { 1, 2, 4, 8, 16, 32, 64, 128 };
+            sweep.sampleRates = { 44100, 48000, 96000 };
+        }
+
+        return sweep;
+    }
+
+    void fillWithTestSignal(juce::AudioBuffer<float>& buffer, int sampleRate)
+    {
+        juce::Random random(1234);
+
+        for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+        {
+            auto* data = buffer.getWritePointer(ch);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                const float t = static_cast<float>(i) / static_cast<float>(sampleRate);
+                data[i] = 0.3f * std::sin(juce::MathConstants<float>::twoPi * 110.0f * t)
+                        + 0.2f * std::sin(juce::MathConstants<float>::twoPi * 880.0f * t)
+                        + 0.1f * (random.nextFloat() * 2.0f - 1.0f);
+            }
+        }
+    }
+
+    // Calls processOneBlock until secondsPerCase of audio has been processed
+    // and returns a result object for the JSON report
+    template <typename Function>
+    juce::var measure(const juce::String& name, int sampleRate, int blockSize, int voices,
+                      double secondsPerCase, Function&& processOneBlock)
+    {
+        for (int i = 0; i < 2; ++i)
+            processOneBlock();
+
+        const int iterations = juce::jmax(4, static_cast<int>(secondsPerCase * sampleRate / blockSize));
+
+        const auto start = juce::Time::getHighResolutionTicks();
+
+        for (int i = 0; i < iterations; ++i)
+            processOneBlock();
+
+        const double elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+        const double samples = static_cast<double>(iterations) * blockSize;
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("benchmark", name);
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("blockSize", blockSize);
+
+        if (voices > 0)
+            result->setProperty("voices", voices);
+
+        result->setProperty("iterations", iterations);
+        result->setProperty("nsPerSample", elapsedSeconds * 1.0e9 / samples);
+        result->setProperty("realtimeFactor", (samples / sampleRate) / juce::jmax(1.0e-12, elapsedSeconds));
+        return juce::var(result);
+    }
+
+    // Like measure(), but calls processOneBlock at the pace of a real audio
+    // callback and times only the calls, so background threads fed by it keep
+    // up as they would in a host
+    template <typename Function>
+    juce::var measurePaced(const juce::String& name, int sampleRate, int blockSize,
+                           double secondsPerCase, Function&& processOneBlock)
+    {
+        const int iterations = juce::jmax(4, static_cast<int>(secondsPerCase * sampleRate / blockSize));
+        const double blockSeconds = static_cast<double>(blockSize) / sampleRate;
+        const auto caseStart = juce::Time::getHighResolutionTicks();
+        juce::int64 busyTicks = 0;
+
+        for (int i = 0; i < iterations; ++i)
+        {
+            const auto callStart = juce::Time::getHighResolutionTicks();
+            processOneBlock();
+            busyTicks += juce::Time::getHighResolutionTicks() - callStart;
+
+            // Wait for the next callback: sleep most of the way, then yield
+            const double due = (i + 1) * blockSeconds;
+
+            for (;;)
+            {
+                const double remaining = due - juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - caseStart);
+
+                if (remaining <= 0.0)
+                    break;
+
+                if (remaining > 0.002)
+                    juce::Thread::sleep(static_cast<int>(remaining * 1000.0) - 1);
+                else
+                    juce::Thread::yield();
+            }
+        }
+
+        const double busySeconds = juce::Time::highResolutionTicksToSeconds(busyTicks);
+        const double samples = static_cast<double>(iterations) * blockSize;
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty("benchmark", name);
+        result->setProperty("sampleRate", sampleRate);
+        result->setProperty("blockSize", blockSize);
+        result->setProperty("iterations", iterations);
+        result->setProperty("nsPerSample", busySeconds * 1.0e9 / samples);
+        result->setProperty("realtimeFactor", (samples / sampleRate) / juce::jmax(1.0e-12, busySeconds));
+        return juce::var(result);
+    }
+
+    void benchmarkDemucsSeparate(const Sweep& sweep, juce::Array<juce::var>& results)
+    {
+        for (int sampleRate : sweep.sampleRates)
+        {
+            DemucsModel* model = demucs_load_model(nullptr, sampleRate);
+
+            for (int blockSize : sweep.blockSizes)
+            {
+                juce::AudioBuffer<float> input(2, blockSize);
+                juce::AudioBuffer<float> stems(8, blockSize);
+                fillWithTestSignal(input, sampleRate);
+
+                results.add(measure("demucs_separate", sampleRate, blockSize, 0, sweep.secondsPerCase, [&]
+                {
+                    demucs_separate_planar(model, input.getArrayOfReadPointers(), 2, 1,
+                                           stems.getArrayOfWritePointers(), 2, 1, blockSize);
+                }));
+            }
+
+            demucs_cleanup(model);
+        }
+    }
+
+    void benchmarkStemSeparator(const Sweep& sweep, juce::Array<juce::var>& results)
+    {
+        for (int sampleRate : sweep.sampleRates)
+        {
+            // Inference itself, on the calling thread over whole segments
+            {
+                StemSeparator separator;
+                juce::AudioBuffer<float> input(2, static_cast<int>(juce::jmax(2.0, 4.0 * sweep.secondsPerCase) * sampleRate));
+                std::array<juce::AudioBuffer<float>, 4> stems;
+                fillWithTestSignal(input, sampleRate);
+
+                // The first call loads the model
+                results.add(measure("StemSeparator::separateOffline", sampleRate, input.getNumSamples(), 0, 0.0, [&]
+                {
+                    separator.separateOffline(input, sampleRate, stems);
+                }));
+            }
+
+            // Audio thread cost only, paced like a host callback: inference runs
+            // on the shared pool meanwhile
+            for (int blockSize : sweep.blockSizes)
+            {
+                StemSeparator separator;
+                separator.initialize(sampleRate, blockSize);
+
+                juce::AudioBuffer<float> input(2, blockSize);
+                std::array<juce::AudioBuffer<float>, 4> stems;
+                for (auto& stem : stems)
+                    stem.setSize(2, blockSize);
+
+                fillWithTestSignal(input, sampleRate);
+
+                results.add(measurePaced("StemSeparator::processBlock (audio thread)", sampleRate, blockSize, sweep.secondsPerCase, [&]
+                {
+                    separator.processBlock(input, stems);
+                }));
+
+                StemSeparator::RemixTargets targets;
+                targets.startGains = { 0.8f, 0.8f, 0.8f, 0.8f };
+                targets.endGains = { 0.8f, 0.7f, 0.8f, 0.9f };
+                juce::AudioBuffer<float> remixBuffer(2, blockSize);
+
+                results.add(measurePaced("StemSeparator::processBlockRemix (audio thread)", sampleRate, blockSize, sweep.secondsPerCase, [&]
+                {
+                    remixBuffer.makeCopyOf(input, true);
+                    separator.processBlockRemix(remixBuffer, targets);
+                }));
+            }
+        }
+    }
+
+    void benchmarkSampler(const Sweep& sweep, juce::Array<juce::var>& results)
+    {
+        const VoiceInterpolator::Mode modes[] = { VoiceInterpolator::Mode::linear,
+                                                  VoiceInterpolator::Mode::hermite,
+                                                  VoiceInterpolator::Mode::sinc };
+
+        const StemStorage::Format formats[] = { StemStorage::Format::float32,
+                                                StemStorage::Format::float16,
+                                                StemStorage::Format::int16 };
+
+        for (int sampleRate : sweep.sampleRates)
+        {
+            juce::AudioBuffer<float> stem(2, sampleRate * 4);
+            fillWithTestSignal(stem, sampleRate);
+
+            for (int blockSize : sweep.blockSizes)
+            {
+                for (int voices : sweep.voiceCounts)
+                {
+                    for (auto mode : modes)
+                    {
+                        for (auto format : formats)
+                        {
+                            SamplerComponent sampler;
+                            sampler.initialize(sampleRate, blockSize);
+                            sampler.setInterpolationMode(mode);
+                            sampler.setPolyphony(voices);
+                            sampler.setStorageFormat(format);
+
+                            for (int i = 0; i < 4; ++i)
+                            {
+                                sampler.loadStem(i, stem, sampleRate);
+                                sampler.setLoopEnabled(i, true);
+                            }
+
+                            // Stems are prepared on the sampler's loader thread
+                            while (sampler.isLoadingStems())
+                                juce::Thread::sleep(1);
+
+                            // Spread the voices over the stems and a few octaves of pitch
+                            for (int v = 0; v < voices; ++v)
+                                sampler.noteOn(48 + v % 24, 0.8f);
+
+                            juce::AudioBuffer<float> output(2, blockSize);
+
+                            auto result = measure("SamplerComponent::processBlock", sampleRate, blockSize, voices, sweep.secondsPerCase, [&]
+                            {
+                                sampler.processBlock(output);
+                            });
+
+                            result.getDynamicObject()->setProperty("interpolation", VoiceInterpolator::getModeName(mode));
+                            result.getDynamicObject()->setProperty("storage", StemStorage::getFormatName(format));
+                            results.add(result);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+//==============================================================================
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    const auto sweep = makeSweep(args.containsOption("--quick"));
+
+    juce::Array<juce::var> results;
+    benchmarkDemucsSeparate(sweep, results);
+    benchmarkStemSeparator(sweep, results);
+    benchmarkSampler(sweep, results);
+
+    auto* report = new juce::DynamicObject();
+    report->setProperty("results", results);
+    const auto json = juce::JSON::toString(juce::var(report));
+
+    if (args.containsOption("--output"))
+    {
+        const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args.getValueForOption("--output"));
+
+        if (!file.replaceWithText(json))
+        {
+            std::cout << "Cannot write " << file.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << json << std::endl;
+    return 0;
+}
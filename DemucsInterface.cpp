@@ -1,33 +1,344 @@
 #include "DemucsInterface.h"
+#include <JuceHeader.h>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 // Simplified Demucs interface implementation
-// In a real implementation, this would interface with PyTorch C++ or ONNX Runtime
+// In a real implementation, this would interface with PyTorch C++ or ONNX Runtime.
+// Without a neural model the built-in spectral separator below is used instead.
+
+namespace
+{
+    constexpr int numStems = 4; // drums, bass, other, vocals
+
+    //==========================================================================
+    // STFT-domain fallback separator. Each frame is split with soft masks that
+    // sum to one, so the four stems always add back up to the input:
+    //   bass   - low band
+    //   drums  - percussive content (smooth across frequency) above the bass band
+    //   vocals - harmonic content (smooth across time) in the vocal band
+    //   other  - harmonic content outside the vocal band
+    // Masks are derived from the channel average so every channel is split the same way.
+    class SpectralSeparator
+    {
+    public:
+        explicit SpectralSeparator(int sampleRate)
+        {
+            const int order = sampleRate > 120000 ? 13 : (sampleRate > 60000 ? 12 : 11);
+            fft = std::make_unique<juce::dsp::FFT>(order);
+            fftSize = fft->getSize();
+            hopSize = fftSize / 4;
+            numBins = fftSize / 2 + 1;
+
+            window.resize(static_cast<size_t>(fftSize));
+            for (int i = 0; i < fftSize; ++i)
+            {
+                window[static_cast<size_t>(i)] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi
+                                                                        * static_cast<float>(i) / static_cast<float>(fftSize));
+            }
+
+            // Hann analysis + Hann synthesis at 75% overlap sums to 1.5
+            synthesisGain = 1.0f / 1.5f;
+
+            lowWeight.resize(static_cast<size_t>(numBins));
+            vocalWeight.resize(static_cast<size_t>(numBins));
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const float freq = static_cast<float>(k) * static_cast<float>(sampleRate) / static_cast<float>(fftSize);
+                lowWeight[static_cast<size_t>(k)] = 1.0f - smoothStep(120.0f, 250.0f, freq);
+                vocalWeight[static_cast<size_t>(k)] = smoothStep(150.0f, 300.0f, freq) * (1.0f - smoothStep(4000.0f, 8000.0f, freq));
+            }
+
+            magnitude.resize(static_cast<size_t>(numBins));
+            harmonic.resize(static_cast<size_t>(numBins));
+            percussive.resize(static_cast<size_t>(numBins));
+            prefix.resize(static_cast<size_t>(numBins + 1));
+            spectrumMid.resize(static_cast<size_t>(fftSize * 2));
+            inverse.resize(static_cast<size_t>(fftSize * 2));
+            frame.resize(static_cast<size_t>(fftSize));
+
+            for (auto& mask : masks)
+                mask.resize(static_cast<size_t>(numBins * 2));
+        }
+
+        // inputs: numChannels pointers, samples inputStride floats apart.
+        // outputs: numStems * numOutputChannels pointers, stem-major, samples
+        // outputStride floats apart (null entries are skipped). Output channels
+        // beyond the input channels repeat the last input channel.
+        void process(const float* const* inputs, int numChannels, int inputStride,
+                     float* const* outputs, int numOutputChannels, int outputStride,
+                     int numSamples)
+        {
+            if (numSamples <= 0 || numChannels <= 0)
+                return;
+
+            prepareChannels(numChannels, numSamples);
+
+            bool firstFrame = true;
+
+            for (int frameStart = hopSize - fftSize; frameStart < numSamples; frameStart += hopSize)
+            {
+                analyseMid(inputs, numChannels, inputStride, frameStart, numSamples);
+                updateMasks(firstFrame);
+                firstFrame = false;
+
+                for (int ch = 0; ch < numChannels; ++ch)
+                    separateChannel(inputs[ch], inputStride, ch, frameStart, numSamples);
+            }
+
+            // Hand the finished region of each overlap-add buffer to the caller
+            for (int stem = 0; stem < numStems; ++stem)
+            {
+                for (int ch = 0; ch < numOutputChannels; ++ch)
+                {
+                    float* dest = outputs[stem * numOutputChannels + ch];
+
+                    if (dest == nullptr)
+                        continue;
+
+                    const float* source = olaBuffer(stem, juce::jmin(ch, numChannels - 1)) + fftSize;
+
+                    if (outputStride == 1)
+                    {
+                        juce::FloatVectorOperations::copyWithMultiply(dest, source, synthesisGain, numSamples);
+                    }
+                    else
+                    {
+                        for (int i = 0; i < numSamples; ++i)
+                            dest[i * outputStride] = source[i] * synthesisGain;
+                    }
+                }
+            }
+        }
+
+    private:
+        static float smoothStep(float edge0, float edge1, float x)
+        {
+            const float t = juce::jlimit(0.0f, 1.0f, (x - edge0) / (edge1 - edge0));
+            return t * t * (3.0f - 2.0f * t);
+        }
+
+        void prepareChannels(int numChannels, int numSamples)
+        {
+            olaLength = numSamples + 2 * fftSize;
+            const auto needed = static_cast<size_t>(numStems * numChannels * olaLength);
+
+            // Grows to the largest segment seen and is reused afterwards
+            if (ola.size() < needed)
+                ola.resize(needed);
+
+            std::fill(ola.begin(), ola.begin() + static_cast<std::ptrdiff_t>(needed), 0.0f);
+            olaChannels = numChannels;
+
+            if (spectra.size() < static_cast<size_t>(numChannels))
+            {
+                spectra.resize(static_cast<size_t>(numChannels));
+                for (auto& s : spectra)
+                    s.resize(static_cast<size_t>(fftSize * 2));
+            }
+        }
+
+        float* olaBuffer(int stem, int channel)
+        {
+            return ola.data() + static_cast<size_t>((stem * olaChannels + channel) * olaLength);
+        }
+
+        // Copies a zero-padded, windowed frame of one channel into dest
+        void readFrame(const float* input, int stride, int frameStart, int numSamples, float* dest) const
+        {
+            const int first = juce::jmax(0, -frameStart);
+            const int last = juce::jmin(fftSize, numSamples - frameStart);
+
+            std::fill(dest, dest + fftSize, 0.0f);
+
+            if (last <= first)
+                return;
+
+            if (stride == 1)
+            {
+                juce::FloatVectorOperations::multiply(dest + first, input + frameStart + first, window.data() + first, last - first);
+            }
+            else
+            {
+                for (int i = first; i < last; ++i)
+                    dest[i] = input[static_cast<std::ptrdiff_t>(frameStart + i) * stride] * window[static_cast<size_t>(i)];
+            }
+        }
+
+        void analyseMid(const float* const* inputs, int numChannels, int stride, int frameStart, int numSamples)
+        {
+            float* mid = spectrumMid.data();
+            std::fill(mid, mid + fftSize * 2, 0.0f);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+            {
+                float* spectrum = spectra[static_cast<size_t>(ch)].data();
+                readFrame(inputs[ch], stride, frameStart, numSamples, spectrum);
+                std::fill(spectrum + fftSize, spectrum + fftSize * 2, 0.0f);
+                fft->performRealOnlyForwardTransform(spectrum, true);
+                juce::FloatVectorOperations::addWithMultiply(mid, spectrum, 1.0f / static_cast<float>(numChannels), numBins * 2);
+            }
+
+            // |X| from the interleaved (re, im) pairs
+            const float* bins = mid;
+            float* mag = magnitude.data();
+
+            for (int k = 0; k < numBins; ++k)
+                mag[k] = std::sqrt(bins[2 * k] * bins[2 * k] + bins[2 * k + 1] * bins[2 * k + 1]);
+        }
+
+        void updateMasks(bool firstFrame)
+        {
+            const float* mag = magnitude.data();
+            float* harm = harmonic.data();
+            float* perc = percussive.data();
+
+            // Harmonic estimate: magnitude smoothed across time
+            if (firstFrame)
+            {
+                std::copy(mag, mag + numBins, harm);
+            }
+            else
+            {
+                juce::FloatVectorOperations::multiply(harm, temporalSmoothing, numBins);
+                juce::FloatVectorOperations::addWithMultiply(harm, mag, 1.0f - temporalSmoothing, numBins);
+            }
+
+            // Percussive estimate: magnitude smoothed across frequency
+            float* sums = prefix.data();
+            sums[0] = 0.0f;
+            for (int k = 0; k < numBins; ++k)
+                sums[k + 1] = sums[k] + mag[k];
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const int lo = juce::jmax(0, k - spectralRadius);
+                const int hi = juce::jmin(numBins, k + spectralRadius + 1);
+                perc[k] = (sums[hi] - sums[lo]) / static_cast<float>(hi - lo);
+            }
+
+            // Soft masks, written as interleaved (m, m) pairs so they multiply the
+            // complex spectrum directly
+            const float* low = lowWeight.data();
+            const float* vocal = vocalWeight.data();
+            float* drums = masks[0].data();
+            float* bass = masks[1].data();
+            float* vocals = masks[3].data();
+
+            for (int k = 0; k < numBins; ++k)
+            {
+                const float h2 = harm[k] * harm[k];
+                const float p2 = perc[k] * perc[k];
+                const float harmonicShare = h2 / (h2 + p2 + 1.0e-12f);
+                const float rest = 1.0f - low[k];
+
+                const float b = low[k];
+                const float d = rest * (1.0f - harmonicShare);
+                const float v = rest * harmonicShare * vocal[k];
+
+                bass[2 * k] = bass[2 * k + 1] = b;
+                drums[2 * k] = drums[2 * k + 1] = d;
+                vocals[2 * k] = vocals[2 * k + 1] = v;
+            }
+        }
+
+        void separateChannel(const float* input, int stride, int channel, int frameStart, int numSamples)
+        {
+            const float* spectrum = spectra[static_cast<size_t>(channel)].data();
+            const int olaOffset = frameStart + fftSize;
+            float* residual = frame.data();
+
+            // "Other" takes whatever the masked stems leave of the windowed frame,
+            // which saves one inverse transform per frame
+            readFrame(input, stride, frameStart, numSamples, residual);
+
+            for (int stem : { 0, 1, 3 })
+            {
+                float* work = inverse.data();
+                juce::FloatVectorOperations::multiply(work, spectrum, masks[static_cast<size_t>(stem)].data(), numBins * 2);
+                std::fill(work + numBins * 2, work + fftSize * 2, 0.0f);
+                fft->performRealOnlyInverseTransform(work);
+
+                juce::FloatVectorOperations::subtract(residual, work, fftSize);
+                juce::FloatVectorOperations::addWithMultiply(olaBuffer(stem, channel) + olaOffset, work, window.data(), fftSize);
+            }
+
+            juce::FloatVectorOperations::addWithMultiply(olaBuffer(2, channel) + olaOffset, residual, window.data(), fftSize);
+        }
+
+        static constexpr float temporalSmoothing = 0.8f;
+        static constexpr int spectralRadius = 8;
+
+        std::unique_ptr<juce::dsp::FFT> fft;
+        int fftSize = 0;
+        int hopSize = 0;
+        int numBins = 0;
+        float synthesisGain = 1.0f;
+
+        std::vector<float> window;
+        std::vector<float> lowWeight;
+        std::vector<float> vocalWeight;
+
+        std::vector<float> magnitude;
+        std::vector<float> harmonic;
+        std::vector<float> percussive;
+        std::vector<float> prefix;
+        std::array<std::vector<float>, numStems> masks;
+
+        std::vector<float> spectrumMid;
+        std::vector<float> inverse;
+        std::vector<float> frame;
+        std::vector<std::vector<float>> spectra;
+
+        std::vector<float> ola;
+        int olaLength = 0;
+        int olaChannels = 0;
+    };
+}
 
 struct DemucsModel {
     int sample_rate;
     int model_type;
     void* torch_model;
-    
-    DemucsModel() : sample_rate(44100), model_type(2), torch_model(nullptr) {}
+    const void* weights;
+    size_t weights_size;
+    std::unique_ptr<SpectralSeparator> fallback;
+    std::vector<float> mono;
+
+    DemucsModel() : sample_rate(44100), model_type(2), torch_model(nullptr), weights(nullptr), weights_size(0) {}
 };
 
 DemucsModel* demucs_load_model(const char* model_path, int sample_rate)
 {
     DemucsModel* model = new DemucsModel();
     model->sample_rate = sample_rate;
-    
+
     // In a real implementation, this would:
     // 1. Load the PyTorch/ONNX model from model_path
     // 2. Initialize the neural network
     // 3. Set up input/output tensors
     // 4. Handle any model-specific initialization
-    
-    // For now, we'll create a placeholder that simulates stem separation
+
     // In production, you'd use something like:
     // model->torch_model = torch::jit::load(model_path);
-    
+
+    // Without a network the spectral separator does the work
+    model->fallback = std::make_unique<SpectralSeparator>(sample_rate);
+
+    return model;
+}
+
+DemucsModel* demucs_load_model_from_memory(const void* weights, size_t num_bytes, int sample_rate)
+{
+    DemucsModel* model = demucs_load_model(nullptr, sample_rate);
+
+    // A real implementation would build the network with tensors that view
+    // these bytes directly (e.g. torch::from_blob) instead of copying them
+    model->weights = weights;
+    model->weights_size = num_bytes;
+
     return model;
 }
 
@@ -44,61 +355,65 @@ void demucs_cleanup(DemucsModel* model)
     }
 }
 
-void demucs_separate(DemucsModel* model, 
+void demucs_separate(DemucsModel* model,
                     const float* input_stereo,
                     float** outputs,
                     int num_samples)
 {
-    if (!model || !input_stereo || !outputs)
+    if (!input_stereo)
+        return;
+
+    // Interleaved stereo is the planar case with a stride of two
+    const float* inputs[] = { input_stereo, input_stereo + 1 };
+    demucs_separate_planar(model, inputs, 2, 2, outputs, 1, 1, num_samples);
+}
+
+void demucs_separate_planar(DemucsModel* model,
+                            const float* const* input_channels,
+                            int num_input_channels,
+                            int input_stride,
+                            float* const* output_channels,
+                            int num_output_channels,
+                            int output_stride,
+                            int num_samples)
+{
+    if (!model || !input_channels || !output_channels
+        || num_input_channels <= 0 || num_output_channels <= 0 || num_samples <= 0)
         return;
-    
-    // This is a simplified placeholder implementation
+
     // A real implementation would:
     // 1. Convert audio to tensor format
     // 2. Preprocess (normalize, windowing, etc.)
     // 3. Run inference through the neural network
     // 4. Post-process the results
     // 5. Convert back to float arrays
-    
-    // For demonstration, we'll use basic frequency-based separation
-    // This is NOT the same as Demucs, but provides a functional demo
-    
-    for (int i = 0; i < num_samples; ++i)
+
+    if (num_output_channels == 1 && num_input_channels > 1)
     {
-        float left = input_stereo[i * 2];
-        float right = input_stereo[i * 2 + 1];
-        float mono = (left + right) * 0.5f;
-        
-        // Simple frequency-based separation for demo
-        // In reality, Demucs uses sophisticated neural networks
-        
-        // Drums: high frequencies (simplified)
-        float drums = mono * 0.3f;
-        
-        // Bass: low frequencies (simplified)  
-        float bass = mono * 0.25f;
-        
-        // Vocals: mid frequencies (simplified)
-        float vocals = mono * 0.35f;
-        
-        // Other: remaining frequencies
-        float other = mono * 0.1f;
-        
-        // Output to separate stems
-        for (int stem = 0; stem < 4; ++stem)
+        // Mono outputs: separate the mid signal
+        if (model->mono.size() < static_cast<size_t>(num_samples))
+            model->mono.resize(static_cast<size_t>(num_samples));
+
+        float* mono = model->mono.data();
+        const float gain = 1.0f / static_cast<float>(num_input_channels);
+
+        for (int i = 0; i < num_samples; ++i)
         {
-            if (outputs[stem])
-            {
-                switch (stem)
-                {
-                    case 0: outputs[stem][i] = drums; break;
-                    case 1: outputs[stem][i] = bass; break;
-                    case 2: outputs[stem][i] = other; break;
-                    case 3: outputs[stem][i] = vocals; break;
-                }
-            }
+            float sum = 0.0f;
+
+            for (int ch = 0; ch < num_input_channels; ++ch)
+                sum += input_channels[ch][static_cast<std::ptrdiff_t>(i) * input_stride];
+
+            mono[i] = sum * gain;
         }
+
+        const float* inputs[] = { mono };
+        model->fallback->process(inputs, 1, 1, output_channels, 1, output_stride, num_samples);
+        return;
     }
+
+    model->fallback->process(input_channels, num_input_channels, input_stride,
+                             output_channels, num_output_channels, output_stride, num_samples);
 }
 
 int demucs_get_sample_rate(const DemucsModel* model)
@@ -110,4 +425,4 @@ int demucs_get_stem_count(const DemucsModel* model)
 {
     // Demucs typically separates into 4 stems
     return 4;
-}
\ No newline at end of file
+}
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,6 +11,11 @@ typedef struct DemucsModel DemucsModel;
 
 // Model management
 DemucsModel* demucs_load_model(const char* model_path, int sample_rate);
+
+// Creates a model around weights owned by the caller, e.g. a read-only
+// memory-mapped file shared between instances. The weights are not copied
+// and must stay valid until demucs_cleanup() is called on the model.
+DemucsModel* demucs_load_model_from_memory(const void* weights, size_t num_bytes, int sample_rate);
 void demucs_cleanup(DemucsModel* model);
 
 // Audio processing
@@ -17,6 +24,21 @@ void demucs_separate(DemucsModel* model,
                     float** outputs, // Array of 4 output buffers (drums, bass, other, vocals)
                     int num_samples);
 
+// Planar audio processing: no interleaving and true stereo stems.
+// input_channels holds num_input_channels pointers whose consecutive samples
+// are input_stride floats apart (1 for planar buffers, 2 for interleaved).
+// output_channels holds 4 * num_output_channels pointers, stem-major
+// (drums L, drums R, bass L, ...), whose samples are output_stride floats apart.
+// Null output pointers are skipped.
+void demucs_separate_planar(DemucsModel* model,
+                            const float* const* input_channels,
+                            int num_input_channels,
+                            int input_stride,
+                            float* const* output_channels,
+                            int num_output_channels,
+                            int output_stride,
+                            int num_samples);
+
 // Utility functions
 int demucs_get_sample_rate(const DemucsModel* model);
 int demucs_get_stem_count(const DemucsModel* model);
@@ -0,0 +1,285 @@
+#include "InferenceMemo.h"
+
+namespace
+{
+    constexpr juce::uint64 hashBase = 0x100000001b3ull;
+
+    inline juce::uint32 floatBits(float value) noexcept
+    {
+        juce::uint32 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline size_t getAnchorSlot(juce::uint64 hash, size_t numSlots) noexcept
+    {
+        return static_cast<size_t>((hash ^ (hash >> 29)) * 0xbf58476d1ce4e5b9ull >> 32) & (numSlots - 1);
+    }
+}
+
+//==============================================================================
+void InferenceMemo::prepare(int newSegmentLength, int newHopSize, int newMaxHistoryLength)
+{
+    segmentLength = newSegmentLength;
+    hopSize = newHopSize;
+
+    // Room for the context of a hop on both passes, plus the hash window
+    const int minHistoryLength = 4 * segmentLength + hashWindow;
+    maxHistoryLength = newMaxHistoryLength > 0 ? juce::jmax(newMaxHistoryLength, minHistoryLength) : 0;
+    historyLength = maxHistoryLength > 0 ? minHistoryLength : 0;
+
+    inputHistory.setSize(numInputChannels, historyLength);
+    stemHistory.setSize(numStemChannels, historyLength);
+
+    anchors.assign(static_cast<size_t>(juce::nextPowerOfTwo(juce::jmax(1, 2 * historyLength / anchorSpacing))), Anchor {});
+
+    windowPower = 1;
+
+    for (int i = 0; i < hashWindow; ++i)
+        windowPower *= hashBase;
+
+    reset();
+}
+
+void InferenceMemo::reset()
+{
+    inputEnd = 0;
+    inputValidFrom = 0;
+    stemsEnd = 0;
+    stemsValidFrom = 0;
+    rollingHash = 0;
+    detectedPeriod = 0;
+    std::fill(anchors.begin(), anchors.end(), Anchor {});
+}
+
+void InferenceMemo::invalidate() noexcept
+{
+    // Overlap-add carries the old model into the next segment's worth of hops
+    stemsValidFrom = stemsEnd + (segmentLength - hopSize);
+}
+
+void InferenceMemo::reserveForPeriod(juce::int64 period)
+{
+    if (!isEnabled() || period <= 0)
+        return;
+
+    // The earlier pass of a hop's whole context, plus the hash window
+    const juce::int64 needed = period + 2 * segmentLength + hashWindow;
+
+    if (needed <= historyLength || needed > maxHistoryLength)
+        return;
+
+    const int newLength = static_cast<int>(needed);
+
+    juce::AudioBuffer<float> newInput(numInputChannels, newLength);
+    juce::AudioBuffer<float> newStems(numStemChannels, newLength);
+    copyRing(inputHistory, newInput, juce::jmax(static_cast<juce::int64>(0), inputEnd - historyLength), inputEnd);
+    copyRing(stemHistory, newStems, juce::jmax(static_cast<juce::int64>(0), stemsEnd - historyLength), stemsEnd);
+    std::swap(inputHistory, newInput);
+    std::swap(stemHistory, newStems);
+
+    // Nothing older than the previous history was kept
+    inputValidFrom = juce::jmax(inputValidFrom, inputEnd - historyLength);
+    stemsValidFrom = juce::jmax(stemsValidFrom, stemsEnd - historyLength);
+
+    // Anchors hold stream positions, so they only need new slots
+    std::vector<Anchor> newAnchors(static_cast<size_t>(juce::nextPowerOfTwo(2 * newLength / anchorSpacing)));
+
+    for (const auto& anchor : anchors)
+        if (anchor.position >= 0)
+            newAnchors[getAnchorSlot(anchor.hash, newAnchors.size())] = anchor;
+
+    anchors = std::move(newAnchors);
+    historyLength = newLength;
+}
+
+void InferenceMemo::copyRing(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest, juce::int64 start, juce::int64 end)
+{
+    const int sourceLength = source.getNumSamples();
+    const int destLength = dest.getNumSamples();
+
+    for (juce::int64 position = start; position < end;)
+    {
+        const int sourceIndex = static_cast<int>(position % sourceLength);
+        const int destIndex = static_cast<int>(position % destLength);
+        const int count = static_cast<int>(juce::jmin(end - position,
+                                                      static_cast<juce::int64>(sourceLength - sourceIndex),
+                                                      static_cast<juce::int64>(destLength - destIndex)));
+
+        for (int ch = 0; ch < dest.getNumChannels(); ++ch)
+            dest.copyFrom(ch, destIndex, source, ch, sourceIndex, count);
+
+        position += count;
+    }
+}
+
+//==============================================================================
+void InferenceMemo::addInput(const juce::AudioBuffer<float>& segment, juce::int64 segmentStart)
+{
+    jassert(segmentStart <= inputEnd);
+
+    const juce::int64 segmentEnd = segmentStart + segment.getNumSamples();
+
+    if (!isEnabled() || segmentEnd <= inputEnd)
+        return;
+
+    for (juce::int64 position = inputEnd; position < segmentEnd;)
+    {
+        const int ringIndex = static_cast<int>(position % historyLength);
+        const int count = static_cast<int>(juce::jmin(segmentEnd - position, static_cast<juce::int64>(historyLength - ringIndex)));
+        const int segmentIndex = static_cast<int>(position - segmentStart);
+
+        for (int ch = 0; ch < numInputChannels; ++ch)
+            inputHistory.copyFrom(ch, ringIndex, segment, juce::jmin(ch, segment.getNumChannels() - 1), segmentIndex, count);
+
+        for (int i = 0; i < count; ++i)
+            updateRollingHash(position + i);
+
+        position += count;
+    }
+
+    inputEnd = segmentEnd;
+}
+
+juce::uint64 InferenceMemo::getSampleValue(juce::int64 position) const noexcept
+{
+    const int ringIndex = static_cast<int>(position % historyLength);
+    return (static_cast<juce::uint64>(floatBits(inputHistory.getSample(0, ringIndex))) << 32)
+         | floatBits(inputHistory.getSample(1, ringIndex));
+}
+
+void InferenceMemo::updateRollingHash(juce::int64 position)
+{
+    rollingHash = rollingHash * hashBase + getSampleValue(position);
+
+    if (position >= hashWindow)
+        rollingHash -= getSampleValue(position - hashWindow) * windowPower;
+
+    // Digital silence hashes to zero and repeats everywhere; it says nothing
+    // about the loop length
+    if (position + 1 < hashWindow || rollingHash == 0)
+        return;
+
+    auto& anchor = anchors[getAnchorSlot(rollingHash, anchors.size())];
+
+    // An earlier window with the same hash: the input probably repeats with
+    // this period. findRepeat() checks before anything is replayed. The
+    // anchor moves to the latest occurrence, so the next pass finds one
+    // period rather than a multiple.
+    if (anchor.hash == rollingHash && anchor.position >= 0 && anchor.position < position
+        && anchor.position - hashWindow >= juce::jmax(inputValidFrom, position - historyLength))
+    {
+        detectedPeriod = position - anchor.position;
+        anchor.position = position;
+    }
+    else if (position % anchorSpacing == 0)
+    {
+        anchor = { rollingHash, position };
+    }
+}
+
+//==============================================================================
+juce::int64 InferenceMemo::findRepeat(juce::int64 hopStart, juce::int64 periodHint) const
+{
+    if (!isEnabled())
+        return -1;
+
+    // Everything that feeds the stems of this hop through overlap-add
+    const juce::int64 contextStart = hopStart - (segmentLength - hopSize);
+    const juce::int64 contextEnd = hopStart + segmentLength;
+
+    const juce::int64 oldestInput = juce::jmax(inputValidFrom, inputEnd - historyLength);
+    const juce::int64 oldestStems = juce::jmax(stemsValidFrom, stemsEnd - historyLength);
+
+    for (const auto period : { periodHint, detectedPeriod })
+    {
+        if (period <= 0)
+            continue;
+
+        const juce::int64 source = hopStart - period;
+
+        if (source < oldestStems || source + hopSize > stemsEnd)
+            continue;
+
+        if (contextStart - period < oldestInput || contextEnd > inputEnd)
+            continue;
+
+        if (inputRepeats(contextStart, contextEnd, period))
+            return source;
+    }
+
+    return -1;
+}
+
+bool InferenceMemo::inputRepeats(juce::int64 start, juce::int64 end, juce::int64 period) const
+{
+    for (juce::int64 position = start; position < end;)
+    {
+        const int current = static_cast<int>(position % historyLength);
+        const int earlier = static_cast<int>((position - period) % historyLength);
+        const int count = static_cast<int>(juce::jmin(end - position,
+                                                      static_cast<juce::int64>(historyLength - current),
+                                                      static_cast<juce::int64>(historyLength - earlier)));
+
+        // Bitwise, so a hit replays stems for exactly the same input
+        for (int ch = 0; ch < numInputChannels; ++ch)
+        {
+            if (std::memcmp(inputHistory.getReadPointer(ch, current), inputHistory.getReadPointer(ch, earlier),
+                            static_cast<size_t>(count) * sizeof(float)) != 0)
+                return false;
+        }
+
+        position += count;
+    }
+
+    return true;
+}
+
+//==============================================================================
+void InferenceMemo::readRing(const juce::AudioBuffer<float>& ring, juce::int64 start, juce::AudioBuffer<float>& dest)
+{
+    const int ringLength = ring.getNumSamples();
+    const int numChannels = juce::jmin(ring.getNumChannels(), dest.getNumChannels());
+
+    for (int done = 0; done < dest.getNumSamples();)
+    {
+        const int ringIndex = static_cast<int>((start + done) % ringLength);
+        const int count = juce::jmin(dest.getNumSamples() - done, ringLength - ringIndex);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            dest.copyFrom(ch, done, ring, ch, ringIndex, count);
+
+        done += count;
+    }
+}
+
+void InferenceMemo::readInput(juce::int64 start, juce::AudioBuffer<float>& dest) const
+{
+    readRing(inputHistory, start, dest);
+}
+
+void InferenceMemo::readStems(juce::int64 start, juce::AudioBuffer<float>& dest) const
+{
+    readRing(stemHistory, start, dest);
+}
+
+void InferenceMemo::addStems(juce::int64 hopStart, const float* const* channels, int numSamples)
+{
+    if (!isEnabled())
+        return;
+
+    jassert(hopStart == stemsEnd);
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int ringIndex = static_cast<int>((hopStart + done) % historyLength);
+        const int count = juce::jmin(numSamples - done, historyLength - ringIndex);
+
+        for (int ch = 0; ch < numStemChannels; ++ch)
+            stemHistory.copyFrom(ch, ringIndex, channels[ch] + done, count);
+
+        done += count;
+    }
+
+    stemsEnd = hopStart + numSamples;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "SegmentScheduler.h"
+
+#ifndef STEMSPLITTER_MEMO_SECONDS
+ #define STEMSPLITTER_MEMO_SECONDS 20 // 0 = off; host loops longer than this are not recognised
+#endif
+
+// Loop-aware memo for the realtime separator. Keeps the recent input stream
+// and the finished stems produced for it; when the whole input context of the
+// next hop is an exact repeat of input seen one period earlier (a host loop),
+// the stems of that earlier pass are replayed instead of running the model.
+//
+// Candidate periods come from the host (loop wraps on the playhead) and from a
+// Rabin-Karp rolling hash that spots repeated windows of input at any offset,
+// so loops need not line up with the hop grid. A candidate is only used once
+// the context has been compared sample for sample, so every hit is exact.
+//
+// The history starts a few segments long, which is enough for the hash to
+// catch short loops; a host loop longer than that grows it (up to the length
+// given to prepare()) once the playhead has wrapped.
+//
+// Positions are in samples of the separator's input stream. Worker thread
+// only.
+class InferenceMemo
+{
+public:
+    static constexpr int numInputChannels = SegmentScheduler::numInputChannels;
+    static constexpr int numStemChannels = SegmentScheduler::numStemChannels;
+
+    InferenceMemo() = default;
+
+    // maxHistoryLength = 0 disables the memo
+    void prepare(int segmentLength, int hopSize, int maxHistoryLength);
+    void reset();
+
+    bool isEnabled() const noexcept { return historyLength > 0; }
+
+    // Stems recorded so far (and the overlap they still feed) came from
+    // another model and must not be replayed
+    void invalidate() noexcept;
+
+    // Grows the history so a loop of this period can be replayed, keeping what
+    // has been recorded. Does nothing for periods longer than the maximum.
+    void reserveForPeriod(juce::int64 period);
+
+    // Records the input of the segment starting at segmentStart; only the part
+    // not seen before is added
+    void addInput(const juce::AudioBuffer<float>& segment, juce::int64 segmentStart);
+
+    // Start of an earlier hop whose stems can stand in for the hop at hopStart,
+    // or -1. periodHint is a loop length reported by the host, or 0.
+    juce::int64 findRepeat(juce::int64 hopStart, juce::int64 periodHint) const;
+
+    // Fills dest (all its samples) with input / stems from start onwards
+    void readInput(juce::int64 start, juce::AudioBuffer<float>& dest) const;
+    void readStems(juce::int64 start, juce::AudioBuffer<float>& dest) const;
+
+    // Records the finished stems of the hop starting at hopStart
+    void addStems(juce::int64 hopStart, const float* const* channels, int numSamples);
+
+private:
+    struct Anchor
+    {
+        juce::uint64 hash = 0;
+        juce::int64 position = -1;
+    };
+
+    static constexpr int hashWindow = 2048;
+    static constexpr int anchorSpacing = 512;
+
+    static void readRing(const juce::AudioBuffer<float>& ring, juce::int64 start, juce::AudioBuffer<float>& dest);
+    static void copyRing(const juce::AudioBuffer<float>& source, juce::AudioBuffer<float>& dest, juce::int64 start, juce::int64 end);
+    bool inputRepeats(juce::int64 start, juce::int64 end, juce::int64 period) const;
+    juce::uint64 getSampleValue(juce::int64 position) const noexcept;
+    void updateRollingHash(juce::int64 position);
+
+    int segmentLength = 0;
+    int hopSize = 0;
+    int historyLength = 0;
+    int maxHistoryLength = 0;
+
+    juce::AudioBuffer<float> inputHistory;
+    juce::AudioBuffer<float> stemHistory;
+    juce::int64 inputEnd = 0;
+    juce::int64 inputValidFrom = 0;
+    juce::int64 stemsEnd = 0;
+    juce::int64 stemsValidFrom = 0;
+
+    // Rolling hash of the last hashWindow input samples; anchors remember the
+    // hash every anchorSpacing samples
+    juce::uint64 rollingHash = 0;
+    juce::uint64 windowPower = 1; // base^hashWindow
+    std::vector<Anchor> anchors;
+    juce::int64 detectedPeriod = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InferenceMemo)
+};
@@ -0,0 +1,291 @@
+#include "InferenceScheduler.h"
+
+//==============================================================================
+class InferenceScheduler::Worker : public juce::Thread
+{
+public:
+    Worker(InferenceScheduler& ownerToUse, int indexToUse)
+        : juce::Thread("Inference " + juce::String(indexToUse)), owner(ownerToUse), index(indexToUse)
+    {
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            Job job;
+
+            if (owner.popJob(index, job) || owner.stealJob(index, job))
+            {
+                owner.runJob(job);
+                continue;
+            }
+
+            // Advertise as idle before looking for ready clients, so a wake-up
+            // between the last look and the wait is never lost
+            idle = true;
+
+            if (const int numQueued = owner.dispatchReadyClients(index); numQueued > 0)
+            {
+                // Wake one more thread for every extra job queued here
+                idle = false;
+                owner.wakeWorkers(numQueued - 1, index);
+                continue;
+            }
+
+            // Audio threads only set a flag, so one idle thread keeps an eye on
+            // it; the rest sleep until they are handed jobs
+            if (owner.startWatching(index))
+            {
+                while (!threadShouldExit() && idle && !owner.takeWorkSignal())
+                    wait(owner.hasClients() ? watchIntervalMs : -1);
+
+                owner.stopWatching();
+            }
+            else
+            {
+                wait(-1);
+            }
+
+            idle = false;
+        }
+    }
+
+    // Claims a sleeping thread for a wake-up; false if it is busy anyway
+    bool claimIfIdle() noexcept
+    {
+        bool expected = true;
+        return idle.compare_exchange_strong(expected, false);
+    }
+
+private:
+    InferenceScheduler& owner;
+    const int index;
+    std::atomic<bool> idle { false };
+};
+
+//==============================================================================
+InferenceScheduler::InferenceScheduler()
+{
+    int numThreads = STEMSPLITTER_INFERENCE_THREADS;
+
+    if (numThreads <= 0)
+        numThreads = juce::jmax(1, juce::SystemStats::getNumCpus() / 2);
+
+    createWorkers(numThreads);
+}
+
+InferenceScheduler::~InferenceScheduler()
+{
+    stopWorkers();
+}
+
+void InferenceScheduler::setNumThreads(int numThreads)
+{
+    // Clients may be waking the workers from their audio threads
+    jassert(!started);
+
+    numThreads = juce::jmax(1, numThreads);
+
+    if (started || numThreads == getNumThreads())
+        return;
+
+    workers.clear();
+    queues.clear();
+    createWorkers(numThreads);
+}
+
+void InferenceScheduler::createWorkers(int numThreads)
+{
+    for (int i = 0; i < numThreads; ++i)
+        queues.push_back(std::make_unique<JobQueue>());
+
+    for (int i = 0; i < numThreads; ++i)
+        workers.push_back(std::make_unique<Worker>(*this, i));
+}
+
+void InferenceScheduler::stopWorkers()
+{
+    for (auto& worker : workers)
+    {
+        worker->signalThreadShouldExit();
+        worker->notify();
+    }
+
+    // Never kill a thread: one may be in the middle of a model call
+    for (auto& worker : workers)
+        worker->waitForThreadToExit(-1);
+}
+
+//==============================================================================
+void InferenceScheduler::addClient(Client* client)
+{
+    auto slot = std::make_shared<ClientSlot>();
+    slot->client = client;
+
+    {
+        const juce::ScopedLock sl(clientLock);
+        clients.push_back(std::move(slot));
+        ++numClients;
+
+        if (!started.exchange(true))
+        {
+            for (auto& worker : workers)
+                worker->startThread();
+        }
+    }
+
+    // A watcher asleep for want of clients starts polling
+    if (const int index = watcher.load(); index >= 0)
+        workers[static_cast<size_t>(index)]->notify();
+}
+
+void InferenceScheduler::removeClient(Client* client)
+{
+    std::shared_ptr<ClientSlot> slot;
+
+    {
+        const juce::ScopedLock sl(clientLock);
+
+        for (auto it = clients.begin(); it != clients.end(); ++it)
+        {
+            if ((*it)->client == client)
+            {
+                slot = *it;
+                clients.erase(it);
+                --numClients;
+                break;
+            }
+        }
+    }
+
+    if (slot == nullptr)
+        return;
+
+    // Pairs with runJob(): either the worker sees the flag and skips the job,
+    // or we see it running and wait for it to finish
+    slot->removed = true;
+
+    while (slot->running)
+        juce::Thread::sleep(1);
+}
+
+bool InferenceScheduler::startWatching(int workerIndex) noexcept
+{
+    int expected = -1;
+    return watcher.compare_exchange_strong(expected, workerIndex);
+}
+
+void InferenceScheduler::wakeWorkers(int numToWake, int excludedIndex)
+{
+    const int numWorkers = static_cast<int>(workers.size());
+
+    if (numToWake <= 0 || numWorkers == 0)
+        return;
+
+    // Busy threads look for more work when they finish, so only sleeping ones
+    // need waking. Start somewhere else each time to spread the wake-ups.
+    const auto first = static_cast<int>(nextToWake++ % static_cast<unsigned int>(numWorkers));
+
+    for (int i = 0; i < numWorkers && numToWake > 0; ++i)
+    {
+        const int index = (first + i) % numWorkers;
+        auto& worker = *workers[static_cast<size_t>(index)];
+
+        if (index != excludedIndex && worker.claimIfIdle())
+        {
+            worker.notify();
+            --numToWake;
+        }
+    }
+}
+
+//==============================================================================
+bool InferenceScheduler::takeEarliest(JobQueue& queue, Job& job)
+{
+    const juce::ScopedLock sl(queue.lock);
+
+    if (queue.jobs.empty())
+        return false;
+
+    auto earliest = queue.jobs.begin();
+
+    for (auto it = queue.jobs.begin(); it != queue.jobs.end(); ++it)
+    {
+        if (it->deadlineMs < earliest->deadlineMs)
+            earliest = it;
+    }
+
+    job = std::move(*earliest);
+    queue.jobs.erase(earliest);
+    return true;
+}
+
+bool InferenceScheduler::popJob(int workerIndex, Job& job)
+{
+    return takeEarliest(*queues[static_cast<size_t>(workerIndex)], job);
+}
+
+bool InferenceScheduler::stealJob(int workerIndex, Job& job)
+{
+    const int numQueues = static_cast<int>(queues.size());
+
+    for (int i = 1; i < numQueues; ++i)
+    {
+        if (takeEarliest(*queues[static_cast<size_t>((workerIndex + i) % numQueues)], job))
+            return true;
+    }
+
+    return false;
+}
+
+int InferenceScheduler::dispatchReadyClients(int workerIndex)
+{
+    const juce::ScopedTryLock sl(clientLock);
+
+    if (!sl.isLocked() || clients.empty())
+        return 0;
+
+    // Start the scan somewhere else each time so no instance is always first
+    const size_t numClients = clients.size();
+    dispatchOffset = (dispatchOffset + 1) % numClients;
+
+    int target = workerIndex;
+    int numQueued = 0;
+    const int numQueues = static_cast<int>(queues.size());
+
+    for (size_t i = 0; i < numClients; ++i)
+    {
+        auto& slot = clients[(dispatchOffset + i) % numClients];
+
+        if (slot->queued || !slot->client->hasPendingWork())
+            continue;
+
+        bool expected = false;
+
+        if (!slot->queued.compare_exchange_strong(expected, true))
+            continue;
+
+        // Spread jobs over the queues; idle workers steal anything left behind
+        auto& queue = *queues[static_cast<size_t>(target)];
+        target = (target + 1) % numQueues;
+
+        const juce::ScopedLock ql(queue.lock);
+        queue.jobs.push_back({ slot, slot->client->getDeadlineMs() });
+        ++numQueued;
+    }
+
+    return numQueued;
+}
+
+void InferenceScheduler::runJob(Job& job)
+{
+    auto& slot = *job.slot;
+    slot.running = true;
+
+    if (!slot.removed)
+        slot.client->processNextUnit();
+
+    slot.running = false;
+    slot.queued = false;
+}
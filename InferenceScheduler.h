@@ -0,0 +1,113 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <deque>
+
+#ifndef STEMSPLITTER_INFERENCE_THREADS
+ #define STEMSPLITTER_INFERENCE_THREADS 0 // 0 = half the logical cores
+#endif
+
+// Process-wide pool that runs separation work for every plugin instance, so the
+// total number of inference threads stays bounded however many instances a
+// session opens. Reach it through juce::SharedResourcePointer.
+//
+// Threads are only started when the first client is added. Clients flag new
+// work with notifyWorkAvailable(), which never blocks; one idle thread watches
+// that flag every watchIntervalMs and polls every client when it is set, the
+// others sleep until a thread with more jobs than it can run wakes them.
+// Each client has at most one job in flight and a job is a single unit of work
+// (one segment), which keeps instances fair. Jobs run earliest-deadline-first;
+// idle threads steal from busy ones.
+class InferenceScheduler
+{
+public:
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        // Called from pool threads; must be cheap and thread-safe
+        virtual bool hasPendingWork() const = 0;
+
+        // juce::Time::getMillisecondCounterHiRes() time by which the next unit
+        // must be finished to avoid an underrun
+        virtual double getDeadlineMs() const = 0;
+
+        // Never called concurrently for the same client
+        virtual void processNextUnit() = 0;
+    };
+
+    InferenceScheduler();
+    ~InferenceScheduler();
+
+    // Starts the pool on first use
+    void addClient(Client* client);
+
+    // Blocks until the client is no longer running on a pool thread
+    void removeClient(Client* client);
+
+    // Flags that a client has work ready. Lock-free, for the audio thread; the
+    // watching thread picks it up within watchIntervalMs.
+    void notifyWorkAvailable() noexcept { workSignalled.store(true, std::memory_order_release); }
+
+    static constexpr int watchIntervalMs = 2;
+
+    // Only before the first client is added
+    void setNumThreads(int numThreads);
+    int getNumThreads() const { return static_cast<int>(workers.size()); }
+
+private:
+    class Worker;
+
+    struct ClientSlot
+    {
+        Client* client = nullptr;
+        std::atomic<bool> queued { false };
+        std::atomic<bool> running { false };
+        std::atomic<bool> removed { false };
+    };
+
+    struct Job
+    {
+        std::shared_ptr<ClientSlot> slot;
+        double deadlineMs = 0.0;
+    };
+
+    struct JobQueue
+    {
+        juce::CriticalSection lock;
+        std::deque<Job> jobs;
+    };
+
+    bool popJob(int workerIndex, Job& job);
+    bool stealJob(int workerIndex, Job& job);
+    bool takeEarliest(JobQueue& queue, Job& job);
+    int dispatchReadyClients(int workerIndex);
+    void runJob(Job& job);
+    void wakeWorkers(int numToWake, int excludedIndex);
+
+    // Idle workers: at most one at a time watches for work flagged by clients
+    bool startWatching(int workerIndex) noexcept;
+    void stopWatching() noexcept { watcher = -1; }
+    bool takeWorkSignal() noexcept { return workSignalled.exchange(false, std::memory_order_acquire); }
+    bool hasClients() const noexcept { return numClients.load() > 0; }
+
+    void createWorkers(int numThreads);
+    void stopWorkers();
+
+    juce::CriticalSection clientLock;
+    std::vector<std::shared_ptr<ClientSlot>> clients;
+    size_t dispatchOffset = 0;
+
+    // Created with the scheduler and left in place, so clients can wake them
+    // from any thread; the threads themselves start with the first client
+    std::vector<std::unique_ptr<JobQueue>> queues;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> started { false };
+    std::atomic<unsigned int> nextToWake { 0 };
+    std::atomic<bool> workSignalled { false };
+    std::atomic<int> watcher { -1 };
+    std::atomic<int> numClients { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(InferenceScheduler)
+};
@@ -0,0 +1,63 @@
+#include "ModelRegistry.h"
+
+ModelRegistry::Weights::Weights(const juce::File& file, int sampleRate)
+    : modelFile(file),
+      modelSampleRate(sampleRate),
+      mappedFile(file, juce::MemoryMappedFile::readOnly)
+{
+}
+
+ModelRegistry::WeightsPtr ModelRegistry::acquire(const juce::String& modelPath, int sampleRate)
+{
+    const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(modelPath);
+    const Key key { file.getFullPathName(), sampleRate };
+
+    const juce::ScopedLock sl(lock);
+
+    auto& entry = entries[key];
+
+    if (auto existing = entry.lock())
+        return existing;
+
+    if (!file.existsAsFile())
+    {
+        entries.erase(key);
+        return nullptr;
+    }
+
+    auto weights = std::make_shared<const Weights>(file, sampleRate);
+
+    if (!weights->isValid())
+    {
+        entries.erase(key);
+        return nullptr;
+    }
+
+    entry = weights;
+
+    // Drop entries whose last user has gone
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.expired())
+            it = entries.erase(it);
+        else
+            ++it;
+    }
+
+    return weights;
+}
+
+int ModelRegistry::getNumLoadedModels() const
+{
+    const juce::ScopedLock sl(lock);
+
+    int count = 0;
+
+    for (const auto& entry : entries)
+    {
+        if (!entry.second.expired())
+            ++count;
+    }
+
+    return count;
+}
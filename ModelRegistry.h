@@ -0,0 +1,50 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include <map>
+
+// Process-wide, reference-counted cache of model weights. Every plugin instance
+// in the process reaches the same registry through a juce::SharedResourcePointer,
+// and weight files are memory-mapped read-only so all instances share one copy
+// of the pages. Weights are unmapped when the last instance lets go of them.
+class ModelRegistry
+{
+public:
+    class Weights
+    {
+    public:
+        Weights(const juce::File& file, int sampleRate);
+
+        bool isValid() const { return mappedFile.getData() != nullptr; }
+        const void* getData() const { return mappedFile.getData(); }
+        size_t getSize() const { return mappedFile.getSize(); }
+
+        const juce::File& getFile() const { return modelFile; }
+        int getSampleRate() const { return modelSampleRate; }
+
+    private:
+        juce::File modelFile;
+        int modelSampleRate;
+        juce::MemoryMappedFile mappedFile;
+
+        JUCE_DECLARE_NON_COPYABLE(Weights)
+    };
+
+    using WeightsPtr = std::shared_ptr<const Weights>;
+
+    ModelRegistry() = default;
+
+    // Returns the shared weights for a model, mapping the file on first use.
+    // Returns nullptr if the file is missing or cannot be mapped.
+    WeightsPtr acquire(const juce::String& modelPath, int sampleRate);
+
+    int getNumLoadedModels() const;
+
+private:
+    using Key = std::pair<juce::String, int>;
+
+    juce::CriticalSection lock;
+    std::map<Key, std::weak_ptr<const Weights>> entries;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ModelRegistry)
+};
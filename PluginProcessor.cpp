@@ -9,6 +9,11 @@ StemSplitterSamplerAudioProcessor::StemSplitterSamplerAudioProcessor()
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
+                       // Optional per-stem outputs, so one instance can feed four mixer channels
+                       .withOutput ("Drums",  juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Bass",   juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Other",  juce::AudioChannelSet::stereo(), false)
+                       .withOutput ("Vocals", juce::AudioChannelSet::stereo(), false)
                      #endif
                        )
 {
@@ -19,6 +24,10 @@ StemSplitterSamplerAudioProcessor::StemSplitterSamplerAudioProcessor()
     addParameter(vocalLevel = new juce::AudioParameterFloat("vocalLevel", "Vocal Level", 0.0f, 1.0f, 0.8f));
     addParameter(separationQuality = new juce::AudioParameterFloat("quality", "Quality", 0.0f, 3.0f, 2.0f));
     addParameter(outputMode = new juce::AudioParameterFloat("outputMode", "Output Mode", 0.0f, 1.0f, 0.0f));
+    addParameter(liveRemix = new juce::AudioParameterFloat("liveRemix", "Live Remix", 0.0f, 1.0f, 1.0f));
+    addParameter(capture = new juce::AudioParameterFloat("capture", "Capture", 0.0f, 1.0f, 0.0f));
+    addParameter(captureSeconds = new juce::AudioParameterFloat("captureSeconds", "Capture Length", 1.0f, 30.0f, 8.0f));
+    addParameter(progressive = new juce::AudioParameterFloat("progressive", "Progressive", 0.0f, 1.0f, 1.0f));
 }
 
 StemSplitterSamplerAudioProcessor::~StemSplitterSamplerAudioProcessor()
@@ -63,6 +72,13 @@ double StemSplitterSamplerAudioProcessor::getTailLengthSeconds() const
     return 0.0;
 }
 
+bool StemSplitterSamplerAudioProcessor::silenceInProducesSilenceOut() const
+{
+    // Silent input gives silent stems (the separator gates it), but MIDI
+    // still plays the sampler without any input
+    return false;
+}
+
 int StemSplitterSamplerAudioProcessor::getNumPrograms()
 {
     return 1;
@@ -96,14 +112,28 @@ void StemSplitterSamplerAudioProcessor::prepareToPlay (double sampleRate, int sa
     stemSeparator = std::make_unique<StemSeparator>();
     stemSeparator->initialize(sampleRate, samplesPerBlock);
     
-    // Initialize sampler
+    // Only live remix waits for the separation worker; the sampler plays
+    // MIDI straight away
+    liveRemixWasOn = *liveRemix >= 0.5f;
+    setLatencySamples(liveRemixWasOn ? stemSeparator->getLatencySamples() : 0);
+    
+    // Initialize sampler; captured takes are separated in the background and
+    // swapped into it while it plays
+    stemCapture.reset();
     sampler = std::make_unique<SamplerComponent>();
     sampler->initialize(sampleRate, samplesPerBlock);
-    
-    // Initialize stem buffers
-    for (auto& buffer : stemBuffers)
+
+    stemCapture = std::make_unique<StemCapture>(*sampler);
+    stemCapture->prepare(sampleRate);
+    captureWasOn = false;
+
+    // Live remix levels glide over 20 ms
+    const std::atomic<float>* levels[] = { drumLevel, bassLevel, otherLevel, vocalLevel };
+
+    for (size_t i = 0; i < 4; ++i)
     {
-        buffer.setSize(2, samplesPerBlock);
+        remixGains[i].reset(sampleRate, 0.02);
+        remixGains[i].setCurrentAndTargetValue(*levels[i]);
     }
 }
 
@@ -131,6 +161,15 @@ bool StemSplitterSamplerAudioProcessor::isBusesLayoutSupported (const BusesLayou
         return false;
    #endif
 
+    // Stem outputs are stereo or switched off
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+    {
+        const auto& set = layouts.getChannelSet(false, bus);
+
+        if (!set.isDisabled() && set != juce::AudioChannelSet::stereo())
+            return false;
+    }
+
     return true;
   #endif
 }
@@ -139,8 +178,6 @@ bool StemSplitterSamplerAudioProcessor::isBusesLayoutSupported (const BusesLayou
 void StemSplitterSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, 
                                                juce::MidiBuffer& midiMessages)
 {
-    juce::ignoreUnused (midiMessages);
-
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -149,39 +186,65 @@ void StemSplitterSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>&
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    if (stemSeparator && sampler)
+    if (stemSeparator && sampler && stemCapture)
     {
-        // Separate stems from input
         stemSeparator->setModelQuality(static_cast<int>(*separationQuality));
-        stemSeparator->processBlock(buffer, stemBuffers);
-        
-        // Load stems into sampler (only do this once when input changes)
-        if (!samplesLoaded)
+        stemCapture->setModelQuality(static_cast<int>(*separationQuality));
+        stemCapture->setProgressive(*progressive >= 0.5f);
+
+        // Loop wraps let the separator replay stems it has already computed
+        if (auto* playHead = getPlayHead())
         {
-            for (int i = 0; i < 4; ++i)
-            {
-                sampler->loadStem(i, stemBuffers[i], currentSampleRate);
-            }
-            samplesLoaded = true;
+            if (auto position = playHead->getPosition())
+                stemSeparator->setPlayheadPosition(position->getTimeInSamples().orFallback(-1),
+                                                   position->getIsPlaying(), buffer.getNumSamples());
         }
-        
-        // Process MIDI and generate output from sampler
-        sampler->processBlock(buffer);
-        
-        // Apply stem level controls
-        if (static_cast<int>(*outputMode) == 0) // All stems mode
+
+        // Record the input before either path overwrites it in place
+        bool captureOn = *capture >= 0.5f;
+
+        // Pressed while the last take is still busy: pop the button back up
+        // so the next press is a fresh rising edge
+        if (captureOn && !captureWasOn && !stemCapture->startCapture(*captureSeconds))
+        {
+            *capture = 0.0f;
+            captureOn = false;
+        }
+
+        captureWasOn = captureOn;
+        stemCapture->pushInput(getBusBuffer(buffer, true, 0));
+
+        // Enabled stem output buses get their stem; in individual mode it also
+        // leaves the main mix
+        std::array<juce::AudioBuffer<float>, 4> stemBusBuffers;
+        std::array<juce::AudioBuffer<float>*, 4> stemBusTargets {};
+
+        for (int i = 0; i < 4 && i + 1 < getBusCount(false); ++i)
         {
-            for (int channel = 0; channel < totalNumOutputChannels; ++channel)
-            {
-                auto* channelData = buffer.getWritePointer(channel);
-                
-                for (int sample = 0; sample < buffer.getNumSamples(); ++sample)
-                {
-                    // Apply stem-specific level controls (simplified)
-                    channelData[sample] *= (*drumLevel + *bassLevel + *otherLevel + *vocalLevel) * 0.25f;
-                }
-            }
+            stemBusBuffers[i] = getBusBuffer(buffer, false, i + 1);
+
+            if (stemBusBuffers[i].getNumChannels() > 0)
+                stemBusTargets[i] = &stemBusBuffers[i];
+        }
+
+        // The reported latency follows the active path. Stems still in the
+        // separator are from before live remix was last switched off.
+        const bool liveRemixOn = *liveRemix >= 0.5f;
+
+        if (liveRemixOn != liveRemixWasOn)
+        {
+            setLatencySamples(liveRemixOn ? stemSeparator->getLatencySamples() : 0);
+
+            if (liveRemixOn)
+                stemSeparator->flush();
+
+            liveRemixWasOn = liveRemixOn;
         }
+
+        if (liveRemixOn)
+            processLiveRemix(buffer, stemBusTargets);
+        else
+            processSampler(buffer, midiMessages, stemBusTargets);
     }
     else
     {
@@ -190,6 +253,72 @@ void StemSplitterSamplerAudioProcessor::processBlock (juce::AudioBuffer<float>&
     }
 }
 
+void StemSplitterSamplerAudioProcessor::processLiveRemix (juce::AudioBuffer<float>& buffer,
+                                                          const std::array<juce::AudioBuffer<float>*, 4>& stemBusTargets)
+{
+    // Stems go straight from the separator's output ring into the outputs,
+    // with the level parameters smoothed across blocks
+    const std::atomic<float>* levels[] = { drumLevel, bassLevel, otherLevel, vocalLevel };
+    const int numSamples = buffer.getNumSamples();
+
+    StemSeparator::RemixTargets targets;
+    targets.stemOutputs = stemBusTargets;
+    targets.removeFromMix = static_cast<int>(*outputMode) == 1;
+
+    for (size_t i = 0; i < 4; ++i)
+    {
+        remixGains[i].setTargetValue(*levels[i]);
+        targets.startGains[i] = remixGains[i].getCurrentValue();
+        targets.endGains[i] = remixGains[i].skip(numSamples);
+    }
+
+    // Main input and output share channels, so the mix replaces the input in place
+    auto mainBuffer = getBusBuffer(buffer, false, 0);
+    stemSeparator->processBlockRemix(mainBuffer, targets);
+}
+
+void StemSplitterSamplerAudioProcessor::processSampler (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages,
+                                                        const std::array<juce::AudioBuffer<float>*, 4>& stemBusTargets)
+{
+    // Stem levels are applied per stem inside the sampler
+    const std::atomic<float>* levels[] = { drumLevel, bassLevel, otherLevel, vocalLevel };
+
+    for (int i = 0; i < 4; ++i)
+    {
+        sampler->setStemLevel(i, *levels[i]);
+    }
+
+    SamplerComponent::StemOutputs stemOutputs;
+    stemOutputs.buffers = stemBusTargets;
+    stemOutputs.removeFromMain = static_cast<int>(*outputMode) == 1;
+
+    // Process MIDI and generate output from sampler: render up to each
+    // event, then apply it, so notes start on their exact sample
+    buffer.clear();
+    auto mainOutput = getBusBuffer(buffer, false, 0);
+
+    const int numSamples = buffer.getNumSamples();
+    int renderedSamples = 0;
+
+    for (const auto metadata : midiMessages)
+    {
+        const int eventPosition = juce::jlimit(renderedSamples, numSamples, metadata.samplePosition);
+
+        if (eventPosition > renderedSamples)
+        {
+            sampler->renderNextBlock(mainOutput, renderedSamples, eventPosition - renderedSamples, stemOutputs);
+            renderedSamples = eventPosition;
+        }
+
+        sampler->handleMidiEvent(metadata.getMessage());
+    }
+
+    if (renderedSamples < numSamples)
+    {
+        sampler->renderNextBlock(mainOutput, renderedSamples, numSamples - renderedSamples, stemOutputs);
+    }
+}
+
 //==============================================================================
 bool StemSplitterSamplerAudioProcessor::hasEditor() const
 {
@@ -212,6 +341,9 @@ void StemSplitterSamplerAudioProcessor::getStateInformation (juce::MemoryBlock&
     stream.writeFloat(*vocalLevel);
     stream.writeFloat(*separationQuality);
     stream.writeFloat(*outputMode);
+    stream.writeFloat(*liveRemix);
+    stream.writeFloat(*captureSeconds);
+    stream.writeFloat(*progressive);
 }
 
 void StemSplitterSamplerAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
@@ -224,6 +356,11 @@ void StemSplitterSamplerAudioProcessor::setStateInformation (const void* data, i
     *vocalLevel = stream.readFloat();
     *separationQuality = stream.readFloat();
     *outputMode = stream.readFloat();
+
+    // Sessions saved before live remix existed keep using the sampler
+    *liveRemix = stream.isExhausted() ? 0.0f : stream.readFloat();
+    *captureSeconds = stream.isExhausted() ? 8.0f : stream.readFloat();
+    *progressive = stream.isExhausted() ? 1.0f : stream.readFloat();
 }
 
 //==============================================================================
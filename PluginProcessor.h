@@ -3,6 +3,7 @@
 #include <JuceHeader.h>
 #include "StemSeparator.h"
 #include "SamplerComponent.h"
+#include "StemCapture.h"
 
 class StemSplitterSamplerAudioProcessor  : public juce::AudioProcessor
 {
@@ -34,7 +35,6 @@ public:
     bool acceptsInput() const override;
     bool producesOutput() const override;
     bool silenceInProducesSilenceOut() const override;
-    double getLatencySamples() const override;
 
     bool hasEditor() const override;
     juce::AudioProcessorEditor* createEditor() override;
@@ -49,13 +49,24 @@ public:
     std::atomic<float>* vocalLevel;
     std::atomic<float>* separationQuality;
     std::atomic<float>* outputMode; // 0=All stems, 1=Selected stem only
+    std::atomic<float>* liveRemix;  // 1=Stems straight to the outputs, 0=Through the sampler
+    std::atomic<float>* capture;    // rising edge records a take for the sampler
+    std::atomic<float>* captureSeconds;
+    std::atomic<float>* progressive; // 1=Preview captured takes at once, then refine
 
 private:
+    void processLiveRemix (juce::AudioBuffer<float>& buffer,
+                           const std::array<juce::AudioBuffer<float>*, 4>& stemBusTargets);
+    void processSampler (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages,
+                         const std::array<juce::AudioBuffer<float>*, 4>& stemBusTargets);
+
     std::unique_ptr<StemSeparator> stemSeparator;
     std::unique_ptr<SamplerComponent> sampler;
-    std::array<juce::AudioBuffer<float>, 4> stemBuffers;
+    std::unique_ptr<StemCapture> stemCapture; // feeds sampler, so destroyed before it
+    std::array<juce::SmoothedValue<float>, 4> remixGains;
     
-    bool samplesLoaded = false;
+    bool captureWasOn = false;
+    bool liveRemixWasOn = false;
     double currentSampleRate = 44100.0;
     int currentBufferSize = 512;
     
@@ -1,38 +1,71 @@
 #include "SamplerComponent.h"
 
-SamplerComponent::SamplerComponent()
+//==============================================================================
+// Prepares newly loaded stems away from the audio thread
+class SamplerComponent::StemLoader : public juce::Thread
 {
-    for (auto& voice : voices)
+public:
+    explicit StemLoader(SamplerComponent& ownerToUse)
+        : juce::Thread("Sampler Stem Loader"), owner(ownerToUse)
     {
-        voice.sampleIndex = -1;
-        voice.position = 0.0;
-        voice.velocity = 0.0f;
-        voice.isActive = false;
-        voice.currentPitch = 1.0f;
     }
-    
-    for (int i = 0; i < 4; ++i)
+
+    void run() override
     {
-        filterFreqSmooth[i].reset(currentSampleRate, 0.01);
-        filterResSmooth[i].reset(currentSampleRate, 0.01);
+        while (!threadShouldExit())
+        {
+            owner.prepareRequestedStems();
+            wait(50);
+        }
     }
+
+private:
+    SamplerComponent& owner;
+};
+
+//==============================================================================
+SamplerComponent::SamplerComponent()
+{
 }
 
 SamplerComponent::~SamplerComponent()
 {
+    if (stemLoader)
+    {
+        stemLoader->stopThread(2000);
+    }
 }
 
 void SamplerComponent::initialize(int sampleRate, int bufferSize)
 {
     currentSampleRate = sampleRate;
     this->bufferSize = bufferSize;
-    
-    for (int i = 0; i < 4; ++i)
+
+    stemBuses.setSize(8, bufferSize);
+    stemBuses.clear();
+
+    VoiceInterpolator::prepare();
+
+    // Stolen and released voices fade out over 5 ms instead of clicking
+    voiceManager.reset();
+    voiceManager.setFadeLength(juce::roundToInt(sampleRate * 0.005));
+
+    if (!stemLoader)
+    {
+        stemLoader = std::make_unique<StemLoader>(*this);
+    }
+
+    stemLoader->startThread();
+
+    filterBank.prepare(sampleRate);
+
+    // Pitch changes glide over 20 ms instead of jumping at block boundaries
+    for (size_t i = 0; i < stemSamples.size(); ++i)
     {
-        filterFreqSmooth[i].reset(sampleRate, 0.01);
-        filterResSmooth[i].reset(sampleRate, 0.01);
-        filterFreqSmooth[i].setCurrentAndTargetValue(20000.0f);
-        filterResSmooth[i].setCurrentAndTargetValue(0.1f);
+        auto& sample = stemSamples[i];
+        sample.pitchSmooth.reset(sampleRate, 0.02);
+        sample.pitchSmooth.setCurrentAndTargetValue(stemParameters[i].pitchRatio.load());
+        sample.pitchRatio = sample.pitchSmooth.getCurrentValue();
     }
 }
 
@@ -40,168 +73,462 @@ void SamplerComponent::loadStem(int stemIndex, const juce::AudioBuffer<float>& s
 {
     if (stemIndex < 0 || stemIndex >= 4)
         return;
-    
-    auto& sample = stemSamples[stemIndex];
-    sample.audioData.makeCopyOf(stemData);
-    sample.sourceSampleRate = sampleRate;
-    sample.endSeconds = stemData.getNumSamples() / sampleRate;
-    sample.isLoaded = true;
-    
+
+    auto request = std::make_unique<StemRequest>();
+    request->audio.makeCopyOf(stemData);
+    request->sampleRate = sampleRate;
+    queueStem(stemIndex, std::move(request));
+
     juce::Logger::writeToLog("Loaded stem " + juce::String(stemIndex) + 
                             " with " + juce::String(stemData.getNumSamples()) + " samples");
 }
 
-void SamplerComponent::noteOn(int midiNote, float velocity)
+void SamplerComponent::loadStems(std::array<juce::AudioBuffer<float>, 4>&& stems, double sampleRate)
 {
-    if (velocity <= 0.0f)
+    for (int i = 0; i < 4; ++i)
+    {
+        auto request = std::make_unique<StemRequest>();
+        request->audio = std::move(stems[static_cast<size_t>(i)]);
+        request->sampleRate = sampleRate;
+        queueStem(i, std::move(request));
+    }
+}
+
+void SamplerComponent::loadSharedStems(const std::array<juce::AudioBuffer<float>, 4>& stems, double sampleRate,
+                                       std::shared_ptr<const void> owner)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& stem = stems[static_cast<size_t>(i)];
+
+        auto request = std::make_unique<StemRequest>();
+        request->audio.setDataToReferTo(const_cast<float**>(stem.getArrayOfReadPointers()),
+                                        stem.getNumChannels(), stem.getNumSamples());
+        request->sampleRate = sampleRate;
+        request->owner = owner;
+        queueStem(i, std::move(request));
+    }
+}
+
+void SamplerComponent::spliceStems(const std::array<juce::AudioBuffer<float>, 4>& stems, int startSample, int numSamples)
+{
+    if (numSamples <= 0)
         return;
-    
-    // Find free voice
-    for (auto& voice : voices)
+
     {
-        if (!voice.isActive)
+        const juce::ScopedLock sl(requestLock);
+
+        for (size_t i = 0; i < stems.size(); ++i)
         {
-            voice.sampleIndex = midiNote % 4; // Map MIDI note to stem
-            voice.position = 0.0;
-            voice.velocity = velocity;
-            voice.isActive = true;
-            voice.currentPitch = midiNoteToFrequency(midiNote) / midiNoteToFrequency(60);
-            break;
+            const auto& stem = stems[i];
+            const int stemLength = stem.getNumSamples();
+
+            if (startSample < 0 || startSample + numSamples > stemLength)
+                continue;
+
+            // Written in whole int16 blocks, so the spliced stem matches a full
+            // reload; only what the mip rebuild reads is copied
+            auto splice = std::make_unique<SpliceRequest>();
+            splice->stemLength = stemLength;
+            splice->startSample = startSample;
+            splice->endSample = startSample + numSamples;
+            StemStorage::alignToBlocks(stemLength, splice->startSample, splice->endSample);
+
+            int sourceEnd = 0;
+            StemMipMap::getRebuildSource(stemLength, splice->startSample, splice->endSample, splice->sourceStart, sourceEnd);
+
+            splice->audio.setSize(stem.getNumChannels(), sourceEnd - splice->sourceStart);
+
+            for (int ch = 0; ch < stem.getNumChannels(); ++ch)
+                splice->audio.copyFrom(ch, 0, stem, ch, splice->sourceStart, sourceEnd - splice->sourceStart);
+
+            requestedSplices[i].push_back(std::move(splice));
         }
     }
+
+    if (stemLoader)
+    {
+        stemLoader->notify();
+    }
 }
 
-void SamplerComponent::noteOff(int midiNote)
+void SamplerComponent::queueStem(int stemIndex, std::unique_ptr<StemRequest> request)
 {
-    // Stop voices with matching MIDI note
-    for (auto& voice : voices)
+    // A newly loaded stem plays in full until its region is edited
+    stemParameters[static_cast<size_t>(stemIndex)].endSeconds = request->audio.getNumSamples() / request->sampleRate;
+
     {
-        if (voice.isActive && voice.sampleIndex == midiNote % 4)
+        const juce::ScopedLock sl(requestLock);
+
+        // A stem still waiting in the queue is simply replaced, and splices
+        // meant for the stem before it are dropped
+        if (requestedStems[static_cast<size_t>(stemIndex)] == nullptr)
+            ++numStemsLoading;
+
+        requestedStems[static_cast<size_t>(stemIndex)] = std::move(request);
+        requestedSplices[static_cast<size_t>(stemIndex)].clear();
+    }
+
+    if (stemLoader)
+    {
+        stemLoader->notify();
+    }
+}
+
+void SamplerComponent::prepareRequestedStems()
+{
+    std::array<std::unique_ptr<StemRequest>, 4> requests;
+    std::array<std::vector<std::unique_ptr<SpliceRequest>>, 4> splices;
+
+    {
+        const juce::ScopedLock sl(requestLock);
+        std::swap(requests, requestedStems);
+        std::swap(splices, requestedSplices);
+    }
+
+    const auto format = storageFormat.load();
+    int numPrepared = 0;
+    bool changed = false;
+
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        if (requests[i] != nullptr)
         {
-            voice.isActive = false;
-            voice.velocity = 0.0f;
+            // Mips are decimated from the full-precision audio, then everything is
+            // stored in the chosen format and the float copy is dropped
+            auto stem = std::make_unique<LoadedStem>();
+            stem->sampleRate = requests[i]->sampleRate;
+            stem->mips.build(requests[i]->audio, format);
+            stem->audio.setFrom(requests[i]->audio, format, requests[i]->owner);
+            requests[i].reset();
+
+            latestStems.stems[i] = std::move(stem);
+            stemLoaded[i] = true;
+            ++numPrepared;
+            changed = true;
         }
+
+        // Published stems are immutable, so a splice goes into a copy
+        for (auto& splice : splices[i])
+        {
+            const auto& base = latestStems.stems[i];
+
+            if (base == nullptr || base->audio.getNumSamples() != splice->stemLength)
+                continue;
+
+            latestStems.stems[i] = spliceStem(*base, *splice);
+            changed = true;
+        }
+    }
+
+    if (changed)
+        stemSetPublisher.publish(std::make_unique<StemSet>(latestStems));
+
+    numStemsLoading -= numPrepared;
+
+    // Sets the renderer has let go of are freed here, never on the audio thread
+    stemSetPublisher.collectGarbage();
+}
+
+std::unique_ptr<SamplerComponent::LoadedStem> SamplerComponent::spliceStem(const LoadedStem& base, const SpliceRequest& splice) const
+{
+    auto stem = std::make_unique<LoadedStem>();
+    stem->sampleRate = base.sampleRate;
+
+    stem->audio.makeCopyOf(base.audio);
+    stem->audio.write(splice.audio, splice.startSample - splice.sourceStart, splice.startSample, splice.endSample - splice.startSample);
+
+    stem->mips.makeCopyOf(base.mips);
+    stem->mips.rebuild(splice.audio, splice.sourceStart, splice.stemLength, splice.startSample, splice.endSample);
+
+    return stem;
+}
+
+void SamplerComponent::adoptPublishedStems()
+{
+    const auto* stems = stemSetPublisher.acquire();
+
+    for (size_t i = 0; i < stemSamples.size(); ++i)
+    {
+        stemSamples[i].stem = stems != nullptr ? stems->stems[i].get() : nullptr;
+    }
+}
+
+void SamplerComponent::applyParameterChanges()
+{
+    for (size_t i = 0; i < stemSamples.size(); ++i)
+    {
+        const auto& parameters = stemParameters[i];
+        auto& sample = stemSamples[i];
+
+        sample.startSeconds = parameters.startSeconds.load(std::memory_order_relaxed);
+        sample.endSeconds = parameters.endSeconds.load(std::memory_order_relaxed);
+        sample.loopEnabled = parameters.loopEnabled.load(std::memory_order_relaxed);
+        sample.pitchSmooth.setTargetValue(parameters.pitchRatio.load(std::memory_order_relaxed));
+        sample.filterFreq = parameters.filterFreq.load(std::memory_order_relaxed);
+        sample.filterRes = parameters.filterRes.load(std::memory_order_relaxed);
     }
+
+    interpolationMode = requestedInterpolationMode.load(std::memory_order_relaxed);
+}
+
+void SamplerComponent::noteOn(int midiNote, float velocity)
+{
+    if (velocity <= 0.0f)
+        return;
+
+    // Allocation settings only matter when a voice starts
+    voiceManager.setPolyphony(requestedPolyphony.load(std::memory_order_relaxed));
+    voiceManager.setStealPolicy(requestedStealPolicy.load(std::memory_order_relaxed));
+
+    // Steals a voice if the polyphony is used up, so no note is dropped
+    auto& voice = voiceManager.startVoice(midiNote);
+    voice.sampleIndex = midiNote % 4; // Map MIDI note to stem
+    voice.position = 0.0;
+    voice.velocity = velocity;
+    voice.currentPitch = midiNoteToFrequency(midiNote) / midiNoteToFrequency(60);
+}
+
+void SamplerComponent::noteOff(int midiNote)
+{
+    // Fade out the voices this note started
+    voiceManager.releaseNote(midiNote);
 }
 
 void SamplerComponent::allNotesOff()
 {
-    for (auto& voice : voices)
+    voiceManager.releaseAll();
+}
+
+void SamplerComponent::handleMidiEvent(const juce::MidiMessage& message)
+{
+    if (message.isNoteOn())
+    {
+        noteOn(message.getNoteNumber(), message.getFloatVelocity());
+    }
+    else if (message.isNoteOff())
+    {
+        noteOff(message.getNoteNumber());
+    }
+    else if (message.isAllNotesOff() || message.isAllSoundOff())
     {
-        voice.isActive = false;
-        voice.velocity = 0.0f;
+        allNotesOff();
     }
 }
 
 void SamplerComponent::processBlock(juce::AudioBuffer<float>& outputBuffer)
 {
     outputBuffer.clear();
-    
-    for (auto& voice : voices)
+    renderNextBlock(outputBuffer, 0, outputBuffer.getNumSamples());
+}
+
+void SamplerComponent::renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples,
+                                       const StemOutputs& stemOutputs)
+{
+    adoptPublishedStems();
+    applyParameterChanges();
+
+    // Render in chunks that fit the scratch buses, so nothing is allocated here
+    const int chunkSize = juce::jmax(1, stemBuses.getNumSamples());
+
+    for (int done = 0; done < numSamples; done += chunkSize)
     {
-        if (!voice.isActive || voice.sampleIndex < 0 || voice.sampleIndex >= 4)
-            continue;
-        
-        auto& sample = stemSamples[voice.sampleIndex];
-        if (!sample.isLoaded)
+        renderBlock(outputBuffer, startSample + done, juce::jmin(chunkSize, numSamples - done), stemOutputs);
+    }
+
+    reportVoicePositions();
+}
+
+void SamplerComponent::reportVoicePositions()
+{
+    int numReported = 0;
+
+    voiceManager.forEachActiveVoice([this, &numReported] (Voice& voice)
+    {
+        if (numReported == maxReportedVoices || voice.sampleIndex < 0 || voice.sampleIndex >= 4)
+            return;
+
+        const auto& sample = stemSamples[static_cast<size_t>(voice.sampleIndex)];
+
+        if (sample.stem == nullptr)
+            return;
+
+        voicePositions[static_cast<size_t>(numReported++)].store(sample.startSeconds + voice.position / sample.stem->sampleRate,
+                                                                 std::memory_order_relaxed);
+    });
+
+    numVoicePositions.store(numReported, std::memory_order_release);
+}
+
+int SamplerComponent::getPlaybackPositions(std::array<double, maxPlaybackPositions>& positions) const
+{
+    int numPositions = 0;
+
+    for (size_t i = 0; i < stemParameters.size(); ++i)
+    {
+        if (stemLoaded[i].load())
+            positions[static_cast<size_t>(numPositions++)] = stemParameters[i].startSeconds.load(std::memory_order_relaxed);
+    }
+
+    const int numVoices = numVoicePositions.load(std::memory_order_acquire);
+
+    for (int i = 0; i < numVoices; ++i)
+        positions[static_cast<size_t>(numPositions++)] = voicePositions[static_cast<size_t>(i)].load(std::memory_order_relaxed);
+
+    return numPositions;
+}
+
+void SamplerComponent::renderBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples,
+                                   const StemOutputs& stemOutputs)
+{
+    stemBusActive.fill(false);
+
+    // Voices hold one pitch per chunk; the smoother moves it between chunks
+    for (auto& sample : stemSamples)
+        sample.pitchRatio = sample.pitchSmooth.skip(numSamples);
+
+    // All buses start silent, so the filter bank can run every stem in one pass
+    for (int ch = 0; ch < stemBuses.getNumChannels(); ++ch)
+        stemBuses.clear(ch, 0, numSamples);
+
+    voiceManager.forEachActiveVoice([this, numSamples] (Voice& voice)
+    {
+        if (voice.sampleIndex < 0 || voice.sampleIndex >= 4 || stemSamples[voice.sampleIndex].stem == nullptr)
+        {
+            voiceManager.freeVoice(voice);
+            return;
+        }
+
+        stemBusActive[voice.sampleIndex] = true;
+
+        if (!renderVoice(voice, numSamples))
+            voiceManager.freeVoice(voice);
+    });
+
+    if (std::find(stemBusActive.begin(), stemBusActive.end(), true) == stemBusActive.end())
+        return;
+
+    for (int stem = 0; stem < 4; ++stem)
+    {
+        filterBank.setParameters(stem, stemSamples[stem].filterFreq, stemSamples[stem].filterRes);
+    }
+
+    filterBank.process(stemBuses, numSamples);
+
+    for (int stem = 0; stem < 4; ++stem)
+    {
+        if (!stemBusActive[stem])
             continue;
-        
-        const int numSamples = outputBuffer.getNumSamples();
-        const int numChannels = outputBuffer.getNumChannels();
-        
-        // Calculate playback parameters
-        const double sampleRateRatio = currentSampleRate / sample.sourceSampleRate;
-        const double pitchModifiedRate = sampleRateRatio * voice.currentPitch * sample.pitchRatio;
-        
-        const int startSample = static_cast<int>(sample.startSeconds * sample.sourceSampleRate);
-        const int endSample = static_cast<int>(sample.endSeconds * sample.sourceSampleRate);
-        const int totalSamples = endSample - startSample;
-        
-        // Generate sample data
-        juce::AudioBuffer<float> voiceBuffer(numChannels, numSamples);
-        voiceBuffer.clear();
-        
-        for (int sampleIdx = 0; sampleIdx < numSamples; ++sampleIdx)
+
+        // Add to the stem's own output and/or the main output
+
+        const float startLevel = appliedStemLevels[stem];
+        const float endLevel = stemLevels[stem];
+        auto* stemOutput = stemOutputs.buffers[stem];
+
+        if (stemOutput != nullptr)
         {
-            const int sourceSample = static_cast<int>(voice.position) + startSample;
-            
-            if (sourceSample >= endSample)
+            for (int ch = 0; ch < stemOutput->getNumChannels(); ++ch)
             {
-                if (sample.loopEnabled && totalSamples > 0)
-                {
-                    voice.position = fmod(voice.position, totalSamples);
-                }
-                else
-                {
-                    voice.isActive = false;
-                    break;
-                }
+                stemOutput->addFromWithRamp(ch, startSample, stemBuses.getReadPointer(stem * 2 + juce::jmin(ch, 1)),
+                                            numSamples, startLevel, endLevel);
             }
-            
-            if (sourceSample >= 0 && sourceSample < sample.audioData.getNumSamples())
-            {
-                for (int ch = 0; ch < numChannels; ++ch)
-                {
-                    const int sourceChannel = juce::jmin(ch, sample.audioData.getNumChannels() - 1);
-                    float sampleValue = sample.audioData.getSample(sourceChannel, sourceSample);
-                    
-                    // Apply velocity and basic envelope
-                    sampleValue *= voice.velocity;
-                    
-                    voiceBuffer.setSample(ch, sampleIdx, sampleValue);
-                }
-            }
-            
-            voice.position += pitchModifiedRate;
         }
-        
-        // Apply filter and add to output
-        applyFilter(voiceBuffer, voice.sampleIndex);
-        
-        for (int ch = 0; ch < numChannels; ++ch)
+
+        if (stemOutput == nullptr || !stemOutputs.removeFromMain)
         {
-            outputBuffer.addFrom(ch, 0, voiceBuffer, ch, 0, numSamples);
+            for (int ch = 0; ch < outputBuffer.getNumChannels(); ++ch)
+            {
+                outputBuffer.addFromWithRamp(ch, startSample, stemBuses.getReadPointer(stem * 2 + juce::jmin(ch, 1)),
+                                             numSamples, startLevel, endLevel);
+            }
         }
+
+        appliedStemLevels[stem] = endLevel;
     }
 }
 
-void SamplerComponent::applyFilter(juce::AudioBuffer<float>& buffer, int sampleIndex)
+bool SamplerComponent::renderVoice(Voice& voice, int numSamples)
 {
-    if (sampleIndex < 0 || sampleIndex >= 4)
-        return;
-    
-    auto& sample = stemSamples[sampleIndex];
-    
-    // Update smoothed values
-    filterFreqSmooth[sampleIndex].setTargetValue(sample.filterFreq);
-    filterResSmooth[sampleIndex].setTargetValue(sample.filterRes);
-    
-    // Apply simple low-pass filter
-    const int numSamples = buffer.getNumSamples();
-    const int numChannels = buffer.getNumChannels();
-    
-    for (int ch = 0; ch < numChannels; ++ch)
-    {
-        auto* channelData = buffer.getWritePointer(ch);
-        
-        for (int n = 0; n < numSamples; ++n)
+    auto& sample = stemSamples[voice.sampleIndex];
+    const auto& stem = *sample.stem;
+
+    // Calculate playback parameters
+    const double sampleRateRatio = stem.sampleRate / currentSampleRate;
+    const double pitchModifiedRate = sampleRateRatio * voice.currentPitch * sample.pitchRatio;
+
+    const int numSourceSamples = stem.audio.getNumSamples();
+    const int startSample = juce::jlimit(0, numSourceSamples, static_cast<int>(sample.startSeconds * stem.sampleRate));
+    const int endSample = juce::jlimit(startSample, numSourceSamples, static_cast<int>(sample.endSeconds * stem.sampleRate));
+    const int totalSamples = endSample - startSample;
+
+    if (totalSamples <= 0 || pitchModifiedRate <= 0.0)
+        return false;
+
+    // Pitched-up voices read a pre-filtered, decimated level, so the kernel
+    // never runs at more than one source sample per output sample
+    const StemStorage* levelData = &stem.audio;
+    double levelScale = 1.0;
+    const int level = stem.mips.chooseLevel(pitchModifiedRate);
+
+    if (level > 0)
+    {
+        levelData = &stem.mips.getLevel(level);
+        levelScale = 1.0 / static_cast<double>(1 << level);
+    }
+
+    // Mono stems feed both sides of the bus
+    const int lastSourceChannel = levelData->getNumChannels() - 1;
+    float* bus[2] = { stemBuses.getWritePointer(voice.sampleIndex * 2),
+                      stemBuses.getWritePointer(voice.sampleIndex * 2 + 1) };
+
+    int done = 0;
+
+    while (done < numSamples)
+    {
+        if (voice.position >= totalSamples)
         {
-            const float freq = filterFreqSmooth[sampleIndex].getNextValue();
-            const float res = filterResSmooth[sampleIndex].getNextValue();
-            
-            // Simple one-pole low-pass filter (for demo purposes)
-            if (freq < 20000.0f)
-            {
-                const float cutoff = juce::jmap(freq, 20.0f, 20000.0f, 0.0f, 1.0f);
-                const float alpha = juce::jlimit(0.0f, 0.99f, 1.0f - cutoff);
-                
-                if (n > 0)
-                {
-                    channelData[n] = alpha * channelData[n-1] + (1.0f - alpha) * channelData[n];
-                }
-            }
+            if (!sample.loopEnabled)
+                return false;
+
+            voice.position = std::fmod(voice.position, static_cast<double>(totalSamples));
+        }
+
+        // Longest run that stays inside the region, so loop and end checks stay out of the kernels
+        int run = juce::jmin(numSamples - done,
+                             static_cast<int>(std::ceil((totalSamples - voice.position) / pitchModifiedRate)));
+
+        while (run > 1 && voice.position + (run - 1) * pitchModifiedRate >= totalSamples)
+            --run;
+
+        run = juce::jmax(1, run);
+
+        // Apply velocity and the declick fade of released or stolen voices
+        float endFade = voice.fadeGain;
+
+        if (voice.isFading())
+        {
+            run = juce::jmin(run, juce::jmax(1, static_cast<int>(std::ceil(voice.fadeGain / voice.fadeStep))));
+            endFade = juce::jmax(0.0f, voice.fadeGain - static_cast<float>(run) * voice.fadeStep);
         }
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            VoiceInterpolator::process(interpolationMode, *levelData, juce::jmin(ch, lastSourceChannel),
+                                       (startSample + voice.position) * levelScale, pitchModifiedRate * levelScale,
+                                       voice.velocity * voice.fadeGain, voice.velocity * endFade,
+                                       bus[ch] + done, run);
+        }
+
+        voice.position += run * pitchModifiedRate;
+        voice.fadeGain = endFade;
+        done += run;
+
+        if (endFade <= 0.0f)
+            return false;
     }
+
+    return true;
 }
 
 float SamplerComponent::midiNoteToFrequency(int midiNote) const
@@ -213,7 +540,7 @@ void SamplerComponent::setSampleStart(int stemIndex, double startSeconds)
 {
     if (stemIndex >= 0 && stemIndex < 4)
     {
-        stemSamples[stemIndex].startSeconds = juce::jmax(0.0, startSeconds);
+        stemParameters[stemIndex].startSeconds = juce::jmax(0.0, startSeconds);
     }
 }
 
@@ -221,7 +548,7 @@ void SamplerComponent::setSampleEnd(int stemIndex, double endSeconds)
 {
     if (stemIndex >= 0 && stemIndex < 4)
     {
-        stemSamples[stemIndex].endSeconds = endSeconds;
+        stemParameters[stemIndex].endSeconds = endSeconds;
     }
 }
 
@@ -229,7 +556,7 @@ void SamplerComponent::setLoopEnabled(int stemIndex, bool shouldLoop)
 {
     if (stemIndex >= 0 && stemIndex < 4)
     {
-        stemSamples[stemIndex].loopEnabled = shouldLoop;
+        stemParameters[stemIndex].loopEnabled = shouldLoop;
     }
 }
 
@@ -237,7 +564,7 @@ void SamplerComponent::setPitch(int stemIndex, float pitchRatio)
 {
     if (stemIndex >= 0 && stemIndex < 4)
     {
-        stemSamples[stemIndex].pitchRatio = juce::jmax(0.1f, pitchRatio);
+        stemParameters[stemIndex].pitchRatio = juce::jmax(0.1f, pitchRatio);
     }
 }
 
@@ -245,22 +572,45 @@ void SamplerComponent::setFilter(int stemIndex, float frequency, float resonance
 {
     if (stemIndex >= 0 && stemIndex < 4)
     {
-        stemSamples[stemIndex].filterFreq = juce::jlimit(20.0f, 20000.0f, frequency);
-        stemSamples[stemIndex].filterRes = juce::jlimit(0.1f, 10.0f, resonance);
+        stemParameters[stemIndex].filterFreq = juce::jlimit(20.0f, 20000.0f, frequency);
+        stemParameters[stemIndex].filterRes = juce::jlimit(0.1f, 10.0f, resonance);
+    }
+}
+
+void SamplerComponent::setInterpolationMode(VoiceInterpolator::Mode mode)
+{
+    requestedInterpolationMode = mode;
+}
+
+void SamplerComponent::setStemLevel(int stemIndex, float level)
+{
+    if (stemIndex >= 0 && stemIndex < 4)
+    {
+        stemLevels[stemIndex] = juce::jmax(0.0f, level);
     }
 }
 
+void SamplerComponent::setPolyphony(int numVoices)
+{
+    requestedPolyphony = numVoices;
+}
+
+void SamplerComponent::setStealPolicy(VoiceManager::StealPolicy policy)
+{
+    requestedStealPolicy = policy;
+}
+
 bool SamplerComponent::isSampleLoaded(int stemIndex) const
 {
-    return (stemIndex >= 0 && stemIndex < 4) ? stemSamples[stemIndex].isLoaded : false;
+    return (stemIndex >= 0 && stemIndex < 4) ? stemLoaded[static_cast<size_t>(stemIndex)].load() : false;
 }
 
 double SamplerComponent::getSampleLength(int stemIndex) const
 {
     if (stemIndex >= 0 && stemIndex < 4)
     {
-        const auto& sample = stemSamples[stemIndex];
-        return sample.endSeconds - sample.startSeconds;
+        const auto& parameters = stemParameters[stemIndex];
+        return parameters.endSeconds.load() - parameters.startSeconds.load();
     }
     return 0.0;
 }
\ No newline at end of file
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "VoiceInterpolator.h"
+#include "StemMipMap.h"
+#include "AtomicPublisher.h"
+#include "VoiceManager.h"
+#include "StemFilterBank.h"
 
 class SamplerComponent
 {
@@ -10,63 +15,208 @@ public:
 
     void initialize(int sampleRate, int bufferSize);
     
-    // Load audio into sampler (from stem separation results)
+    // Load audio into sampler (from stem separation results). Returns at once:
+    // the loader thread prepares the stem and swaps it in atomically, so this
+    // may be called from any non-realtime thread while the sampler is playing.
     void loadStem(int stemIndex, const juce::AudioBuffer<float>& stemData, double sampleRate);
+
+    // Takes over a whole set of separated stems without copying them
+    void loadStems(std::array<juce::AudioBuffer<float>, 4>&& stems, double sampleRate);
+
+    // Plays stems that live in memory owned elsewhere (a mapped StemCache
+    // entry); owner is kept alive while they are in use. With float32 storage
+    // the samples are read in place, not copied.
+    void loadSharedStems(const std::array<juce::AudioBuffer<float>, 4>& stems, double sampleRate,
+                         std::shared_ptr<const void> owner);
+
+    // Replaces samples [startSample, startSample + numSamples) of all four
+    // loaded stems with the same range of stems (full-length, like the ones
+    // loaded), e.g. as parts of a take are refined. Only that range and the
+    // mip samples it reaches are rebuilt, and the sample regions are kept.
+    void spliceStems(const std::array<juce::AudioBuffer<float>, 4>& stems, int startSample, int numSamples);
+
+    // True while loaded stems are still being prepared
+    bool isLoadingStems() const { return numStemsLoading.load() > 0; }
+
+    // Storage for stems loaded from now on: float32 (default), or float16 /
+    // dithered int16 at half the memory
+    void setStorageFormat(StemStorage::Format format) { storageFormat = format; }
     
     // Playback control
     void noteOn(int midiNote, float velocity);
     void noteOff(int midiNote);
     void allNotesOff();
+    void handleMidiEvent(const juce::MidiMessage& message);
     
+    // Per-block routing of the stems: a stem with a buffer here (e.g. a host aux
+    // bus) is written to it, and also to the main output unless removeFromMain
+    struct StemOutputs
+    {
+        std::array<juce::AudioBuffer<float>*, 4> buffers {};
+        bool removeFromMain = false;
+    };
+
     // Process audio
     void processBlock(juce::AudioBuffer<float>& outputBuffer);
+
+    // Adds the next numSamples of voice output into outputBuffer at startSample;
+    // used to render between MIDI events
+    void renderNextBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples,
+                         const StemOutputs& stemOutputs = {});
     
-    // Sampler parameters
+    // Sampler parameters; safe to call from any thread while playing. The
+    // renderer picks changes up at the start of its next block.
     void setSampleStart(int stemIndex, double startSeconds);
     void setSampleEnd(int stemIndex, double endSeconds);
     void setLoopEnabled(int stemIndex, bool shouldLoop);
     void setPitch(int stemIndex, float pitchRatio);
     void setFilter(int stemIndex, float frequency, float resonance);
+    void setInterpolationMode(VoiceInterpolator::Mode mode);
+
+    // Output level per stem, ramped across each block
+    void setStemLevel(int stemIndex, float level);
+
+    // Voice allocation (polyphony up to VoiceManager::maxPolyphony); also
+    // safe from any thread, applied at the next note-on
+    void setPolyphony(int numVoices);
+    void setStealPolicy(VoiceManager::StealPolicy policy);
     
+    static constexpr int maxReportedVoices = 8;
+    static constexpr int maxPlaybackPositions = 4 + maxReportedVoices;
+
+    // Where the loaded stems are being heard, in seconds into them (any
+    // thread): the region start of every loaded stem, then the positions of up
+    // to maxReportedVoices sounding voices as of the last rendered block.
+    // Returns how many positions were written.
+    int getPlaybackPositions(std::array<double, maxPlaybackPositions>& positions) const;
+
     // Get current loaded sample info
     bool isSampleLoaded(int stemIndex) const;
     double getSampleLength(int stemIndex) const;
     
 private:
+    // A stem waiting for the loader thread
+    struct StemRequest
+    {
+        juce::AudioBuffer<float> audio;
+        double sampleRate = 44100.0;
+        std::shared_ptr<const void> owner; // set when audio refers to shared memory
+    };
+
+    // New samples for part of a loaded stem: audio holds the stem from
+    // sourceStart on, covering what the mip rebuild reads
+    struct SpliceRequest
+    {
+        juce::AudioBuffer<float> audio;
+        int sourceStart = 0;
+        int stemLength = 0;
+        int startSample = 0;
+        int endSample = 0;
+    };
+
+    // One stem's audio and mip levels; immutable once published
+    struct LoadedStem
+    {
+        StemStorage audio;
+        double sampleRate = 44100.0;
+        StemMipMap mips;
+    };
+
+    // Everything the renderer plays from. The loader thread publishes a new set
+    // for every load; sets share the stems that did not change.
+    struct StemSet
+    {
+        std::array<std::shared_ptr<const LoadedStem>, 4> stems;
+    };
+
+    // Written by the setters, read once per block by the renderer. Each stem
+    // gets its own cache line, so edits never contend with the render state.
+    struct alignas(64) StemParameters
+    {
+        std::atomic<double> startSeconds { 0.0 };
+        std::atomic<double> endSeconds { 0.0 };
+        std::atomic<bool> loopEnabled { false };
+        std::atomic<float> pitchRatio { 1.0f };
+        std::atomic<float> filterFreq { 20000.0f };
+        std::atomic<float> filterRes { 0.1f };
+    };
+
+    // Audio thread only: the parameters in effect for the current block
     struct SampleData
     {
-        juce::AudioBuffer<float> audioData;
-        double sourceSampleRate = 44100.0;
+        const LoadedStem* stem = nullptr; // from the adopted StemSet
         double startSeconds = 0.0;
         double endSeconds = 0.0;
         bool loopEnabled = false;
         float pitchRatio = 1.0f;
-        bool isLoaded = false;
+        juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> pitchSmooth { 1.0f };
         
-        // Filter parameters
+        // Filter parameters (smoothed by the filter bank)
         float filterFreq = 20000.0f;
         float filterRes = 0.1f;
     };
     
-    struct Voice
-    {
-        int sampleIndex = -1;
-        double position = 0.0;
-        float velocity = 0.0f;
-        bool isActive = false;
-        float currentPitch = 1.0f;
-    };
-    
-    void applyFilter(juce::AudioBuffer<float>& buffer, int sampleIndex);
+    using Voice = VoiceManager::Voice;
+
+    class StemLoader;
+
+    void queueStem(int stemIndex, std::unique_ptr<StemRequest> request);
+
+    // Loader thread: builds mip levels for queued stems and publishes a new StemSet
+    void prepareRequestedStems();
+    std::unique_ptr<LoadedStem> spliceStem(const LoadedStem& base, const SpliceRequest& splice) const;
+
+    // Audio thread: switches to the latest published StemSet
+    void adoptPublishedStems();
+
+    // Audio thread: copies the latest parameter values into stemSamples
+    void applyParameterChanges();
+
+    // Audio thread: records where the sounding voices are for getPlaybackPositions()
+    void reportVoicePositions();
+
+    void renderBlock(juce::AudioBuffer<float>& outputBuffer, int startSample, int numSamples,
+                     const StemOutputs& stemOutputs);
+    bool renderVoice(Voice& voice, int numSamples);
     float midiNoteToFrequency(int midiNote) const;
     
     std::array<SampleData, 4> stemSamples;
-    std::array<Voice, 16> voices; // Polyphony limit
+    std::array<StemParameters, 4> stemParameters;
+    VoiceManager voiceManager;
     int currentSampleRate = 44100;
     int bufferSize = 512;
+    VoiceInterpolator::Mode interpolationMode = VoiceInterpolator::Mode::hermite; // audio thread
+
+    // Written by the setters; the renderer and noteOn() apply them
+    std::atomic<VoiceInterpolator::Mode> requestedInterpolationMode { VoiceInterpolator::Mode::hermite };
+    std::atomic<int> requestedPolyphony { 16 };
+    std::atomic<VoiceManager::StealPolicy> requestedStealPolicy { VoiceManager::StealPolicy::oldest };
+
+    // One stereo bus per stem, sized in initialize(); voices accumulate into
+    // their stem's bus, the filter bank runs over all buses at once and the
+    // result is mixed into the output
+    juce::AudioBuffer<float> stemBuses;
+    std::array<bool, 4> stemBusActive {};
+    std::array<std::atomic<float>, 4> stemLevels { 1.0f, 1.0f, 1.0f, 1.0f };
+    std::array<float, 4> appliedStemLevels { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // Loading: stems queue up under requestLock (non-realtime threads only), the
+    // loader thread publishes StemSets and frees the ones the renderer retired
+    juce::CriticalSection requestLock;
+    std::array<std::unique_ptr<StemRequest>, 4> requestedStems;
+    std::array<std::vector<std::unique_ptr<SpliceRequest>>, 4> requestedSplices; // applied after requestedStems
+    std::atomic<StemStorage::Format> storageFormat { StemStorage::Format::float32 };
+    std::atomic<int> numStemsLoading { 0 };
+    std::array<std::atomic<bool>, 4> stemLoaded {};
+    StemSet latestStems; // loader thread only
+    AtomicPublisher<StemSet> stemSetPublisher;
+    std::unique_ptr<StemLoader> stemLoader;
     
-    juce::SmoothedValue<float> filterFreqSmooth[4];
-    juce::SmoothedValue<float> filterResSmooth[4];
+    // Written by reportVoicePositions(), read by getPlaybackPositions()
+    std::array<std::atomic<double>, maxReportedVoices> voicePositions {};
+    std::atomic<int> numVoicePositions { 0 };
+
+    StemFilterBank filterBank;
     
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SamplerComponent)
 };
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "SegmentScheduler.h"
+
+SegmentScheduler::SegmentScheduler()
+{
+    prepare(8192, 0.5f);
+}
+
+void SegmentScheduler::prepare(int newSegmentLength, float overlap)
+{
+    overlap = juce::jlimit(0.0f, 0.9f, overlap);
+    hopsPerSegment = juce::jmax(1, juce::roundToInt(1.0f / (1.0f - overlap)));
+
+    hopSize = juce::jmax(1, newSegmentLength / hopsPerSegment);
+    segmentLength = hopSize * hopsPerSegment;
+
+    window.allocate(static_cast<size_t>(segmentLength), false);
+
+    if (hopsPerSegment == 1)
+    {
+        // No overlap: plain rectangular segments
+        juce::FloatVectorOperations::fill(window.get(), 1.0f, segmentLength);
+    }
+    else
+    {
+        // Periodic Hann, normalised so the overlapping windows sum to one
+        for (int i = 0; i < segmentLength; ++i)
+        {
+            window[i] = 0.5f - 0.5f * std::cos(juce::MathConstants<float>::twoPi
+                                               * static_cast<float>(i) / static_cast<float>(segmentLength));
+        }
+
+        for (int i = 0; i < hopSize; ++i)
+        {
+            float sum = 0.0f;
+
+            for (int k = 0; k < hopsPerSegment; ++k)
+                sum += window[i + k * hopSize];
+
+            const float gain = sum > 0.0f ? 1.0f / sum : 0.0f;
+
+            for (int k = 0; k < hopsPerSegment; ++k)
+                window[i + k * hopSize] *= gain;
+        }
+    }
+
+    segmentBuffer.setSize(numInputChannels, segmentLength);
+    stemBuffer.setSize(numStemChannels, segmentLength);
+    accumulator.setSize(numStemChannels, segmentLength);
+
+    reset();
+}
+
+void SegmentScheduler::reset()
+{
+    segmentBuffer.clear();
+    stemBuffer.clear();
+    accumulator.clear();
+    currentHop = 0;
+}
+
+void SegmentScheduler::accumulateSegment()
+{
+    // The segment starts at the current hop and wraps around the accumulator
+    const int firstPart = (hopsPerSegment - currentHop) * hopSize;
+    const int secondPart = segmentLength - firstPart;
+    const int offset = currentHop * hopSize;
+
+    for (int ch = 0; ch < numStemChannels; ++ch)
+    {
+        const float* stems = stemBuffer.getReadPointer(ch);
+        float* acc = accumulator.getWritePointer(ch);
+
+        juce::FloatVectorOperations::addWithMultiply(acc + offset, stems, window.get(), firstPart);
+
+        if (secondPart > 0)
+            juce::FloatVectorOperations::addWithMultiply(acc, stems + firstPart, window.get() + firstPart, secondPart);
+    }
+}
+
+const float* SegmentScheduler::getCompletedHop(int stemChannel) const
+{
+    return accumulator.getReadPointer(stemChannel, currentHop * hopSize);
+}
+
+void SegmentScheduler::finishHop()
+{
+    accumulator.clear(currentHop * hopSize, hopSize);
+    currentHop = (currentHop + 1) % hopsPerSegment;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Cuts a continuous stream into fixed-length, overlapping segments for the
+// separation model and rebuilds the stem streams with windowed overlap-add.
+//
+// Per segment the caller fills getSegmentBuffer(), runs inference into
+// getStemBuffer(), then calls accumulateSegment(). After that one hop of
+// finished stems can be read with getCompletedHop() and released with
+// finishHop(). All buffers are sized in prepare() and reused.
+class SegmentScheduler
+{
+public:
+    static constexpr int numInputChannels = 2;
+    static constexpr int numStemChannels = 8; // 4 stems x stereo
+
+    SegmentScheduler();
+
+    // The overlap is rounded so that the segment holds a whole number of hops
+    // (0 -> no overlap, 0.5 -> half, 0.75 -> three quarters, ...)
+    void prepare(int segmentLength, float overlap);
+    void reset();
+
+    int getSegmentLength() const { return segmentLength; }
+    int getHopSize() const { return hopSize; }
+
+    // Input history the stream must be primed with before the first segment
+    int getPrimingSamples() const { return segmentLength - hopSize; }
+
+    juce::AudioBuffer<float>& getSegmentBuffer() { return segmentBuffer; }
+    juce::AudioBuffer<float>& getStemBuffer() { return stemBuffer; }
+
+    // Windows the stem buffer and adds it into the overlap-add accumulator
+    void accumulateSegment();
+
+    const float* getCompletedHop(int stemChannel) const;
+    void finishHop();
+
+private:
+    int segmentLength = 0;
+    int hopSize = 0;
+    int hopsPerSegment = 1;
+    int currentHop = 0;
+
+    // Analysis window with the overlap-add normalisation folded in
+    juce::HeapBlock<float> window;
+
+    juce::AudioBuffer<float> segmentBuffer;
+    juce::AudioBuffer<float> stemBuffer;
+
+    // Circular in units of hops, so a completed hop is always contiguous
+    juce::AudioBuffer<float> accumulator;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SegmentScheduler)
+};
@@ -0,0 +1,75 @@
+#include "SilenceGate.h"
+
+namespace
+{
+    // Shortest fade in when segments do not overlap
+    constexpr int minFadeSamples = 64;
+}
+
+void SilenceGate::prepare(double sampleRate, int segmentLength, int hopSize, float thresholdDb)
+{
+    openLevel = juce::Decibels::decibelsToGain(thresholdDb);
+    closeLevel = juce::Decibels::decibelsToGain(thresholdDb - hysteresisDb);
+    holdSegments = juce::jmax(1, juce::roundToInt(holdSeconds * sampleRate / hopSize));
+
+    // An opening segment was quiet up to its last hop (the previous segment
+    // covered the rest), so the fade in fits in front of the new audio
+    fadeLength = juce::jlimit(1, segmentLength, juce::jmax(segmentLength - hopSize, minFadeSamples));
+
+    fadeInRamp.allocate(static_cast<size_t>(segmentLength), false);
+    fadeOutRamp.allocate(static_cast<size_t>(segmentLength), false);
+
+    for (int i = 0; i < segmentLength; ++i)
+    {
+        fadeInRamp[i] = juce::jmin(1.0f, static_cast<float>(i) / static_cast<float>(fadeLength));
+        fadeOutRamp[i] = 1.0f - static_cast<float>(i) / static_cast<float>(segmentLength);
+    }
+
+    reset();
+}
+
+void SilenceGate::reset()
+{
+    // Streams start primed with silence
+    isOpen = false;
+    quietSegments = 0;
+}
+
+SilenceGate::State SilenceGate::process(const juce::AudioBuffer<float>& segment)
+{
+    float level = 0.0f;
+
+    for (int ch = 0; ch < segment.getNumChannels(); ++ch)
+        level = juce::jmax(level, segment.getRMSLevel(ch, 0, segment.getNumSamples()));
+
+    if (!isOpen)
+    {
+        if (level <= openLevel)
+            return State::closed;
+
+        isOpen = true;
+        quietSegments = 0;
+        return State::opening;
+    }
+
+    quietSegments = level < closeLevel ? quietSegments + 1 : 0;
+
+    if (quietSegments < holdSegments)
+        return State::open;
+
+    isOpen = false;
+    return State::closing;
+}
+
+void SilenceGate::applyFade(State state, juce::AudioBuffer<float>& stems) const
+{
+    const float* ramp = state == State::opening ? fadeInRamp.get()
+                      : state == State::closing ? fadeOutRamp.get()
+                      : nullptr;
+
+    if (ramp == nullptr)
+        return;
+
+    for (int ch = 0; ch < stems.getNumChannels(); ++ch)
+        juce::FloatVectorOperations::multiply(stems.getWritePointer(ch), ramp, stems.getNumSamples());
+}
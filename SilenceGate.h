@@ -0,0 +1,58 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#ifndef STEMSPLITTER_GATE_THRESHOLD_DB
+ #define STEMSPLITTER_GATE_THRESHOLD_DB -80.0f // segments quieter than this skip the model
+#endif
+
+// Energy gate in front of the separation model. Segments whose RMS stays below
+// the threshold produce silent stems without running inference; the gate opens
+// as soon as a segment rises above the threshold and closes only after
+// holdSeconds of segments below threshold - hysteresisDb, so it does not
+// chatter on material hovering around the threshold.
+//
+// The segment that opens or closes the gate is still separated, and its stems
+// fade in or out across the part of the segment that was already quiet, so
+// the edges are crossfaded rather than cut.
+class SilenceGate
+{
+public:
+    static constexpr float hysteresisDb = 6.0f;
+    static constexpr double holdSeconds = 0.2;
+
+    enum class State
+    {
+        closed,  // skip inference, stems are silent
+        opening, // run inference, then fadeIn()
+        open,    // run inference
+        closing  // run inference, then fadeOut()
+    };
+
+    SilenceGate() = default;
+
+    void prepare(double sampleRate, int segmentLength, int hopSize, float thresholdDb = STEMSPLITTER_GATE_THRESHOLD_DB);
+    void reset();
+
+    // Measures the next segment (one hop after the previous one) and advances
+    // the gate
+    State process(const juce::AudioBuffer<float>& segment);
+
+    static bool needsInference(State state) noexcept { return state != State::closed; }
+
+    // Applies the crossfade for an opening or closing segment's stems in place
+    void applyFade(State state, juce::AudioBuffer<float>& stems) const;
+
+private:
+    float openLevel = 0.0f;
+    float closeLevel = 0.0f;
+    int holdSegments = 1;
+    int quietSegments = 0;
+    bool isOpen = false;
+
+    juce::HeapBlock<float> fadeInRamp;
+    juce::HeapBlock<float> fadeOutRamp;
+    int fadeLength = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(SilenceGate)
+};
@@ -0,0 +1,240 @@
+#include "StemCache.h"
+
+namespace
+{
+    constexpr juce::uint32 fileMagic = 0x434d5453; // "STMC"
+    constexpr juce::uint32 fileVersion = 1;
+
+    struct FileHeader
+    {
+        juce::uint32 magic;
+        juce::uint32 version;
+        juce::uint32 numStems;
+        juce::uint32 numChannels;
+        juce::int64 numSamples;
+        double sampleRate;
+        juce::uint8 reserved[32];
+    };
+
+    static_assert(sizeof(FileHeader) == 64, "sample data must start 64-byte aligned");
+
+    // Two independent multiply-rotate lanes over 64-bit words
+    struct Hasher
+    {
+        juce::uint64 a = 0x9e3779b97f4a7c15ull;
+        juce::uint64 b = 0xc2b2ae3d27d4eb4full;
+
+        static juce::uint64 rotate(juce::uint64 x, int bits) noexcept { return (x << bits) | (x >> (64 - bits)); }
+
+        void addWord(juce::uint64 word) noexcept
+        {
+            a = rotate(a ^ word, 31) * 0x9e3779b97f4a7c15ull;
+            b = rotate(b + word, 27) * 0xff51afd7ed558ccdull;
+        }
+
+        void addBytes(const void* data, size_t numBytes) noexcept
+        {
+            const auto* bytes = static_cast<const juce::uint8*>(data);
+            size_t i = 0;
+
+            for (; i + 8 <= numBytes; i += 8)
+            {
+                juce::uint64 word;
+                std::memcpy(&word, bytes + i, sizeof(word));
+                addWord(word);
+            }
+
+            juce::uint64 tail = numBytes;
+
+            for (; i < numBytes; ++i)
+                tail = (tail << 8) | bytes[i];
+
+            addWord(tail);
+        }
+
+        juce::String toString() const
+        {
+            return juce::String::toHexString(static_cast<juce::int64>(a)).paddedLeft('0', 16)
+                 + juce::String::toHexString(static_cast<juce::int64>(b)).paddedLeft('0', 16);
+        }
+    };
+}
+
+//==============================================================================
+StemCache::Entry::Entry(const juce::File& file)
+    : mappedFile(file, juce::MemoryMappedFile::readOnly)
+{
+    const auto* data = static_cast<const char*>(mappedFile.getData());
+
+    if (data == nullptr || mappedFile.getSize() < sizeof(FileHeader))
+        return;
+
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    if (header.magic != fileMagic || header.version != fileVersion || header.numStems != 4
+        || header.numChannels == 0 || header.numSamples <= 0 || header.numSamples > std::numeric_limits<int>::max())
+        return;
+
+    const auto numChannels = static_cast<int>(header.numChannels);
+    const auto numSamples = static_cast<int>(header.numSamples);
+    const size_t stemBytes = static_cast<size_t>(numChannels) * static_cast<size_t>(numSamples) * sizeof(float);
+
+    if (mappedFile.getSize() != sizeof(FileHeader) + 4 * stemBytes)
+        return;
+
+    // The mapping is read-only; the buffers only ever hand out read pointers
+    auto* samples = const_cast<float*>(reinterpret_cast<const float*>(data + sizeof(FileHeader)));
+
+    for (size_t stem = 0; stem < stems.size(); ++stem)
+    {
+        float* channels[8] {};
+        const int numMapped = juce::jmin(numChannels, juce::numElementsInArray(channels));
+
+        for (int ch = 0; ch < numMapped; ++ch)
+            channels[ch] = samples + (stem * static_cast<size_t>(numChannels) + static_cast<size_t>(ch)) * static_cast<size_t>(numSamples);
+
+        stems[stem].setDataToReferTo(channels, numMapped, numSamples);
+    }
+
+    sampleRate = header.sampleRate;
+    valid = true;
+}
+
+//==============================================================================
+StemCache::StemCache(const juce::File& directoryToUse)
+    : directory(directoryToUse)
+{
+}
+
+juce::File StemCache::getDefaultDirectory()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("StemSplitterSampler")
+               .getChildFile("StemCache");
+}
+
+juce::String StemCache::makeKey(const juce::AudioBuffer<float>& input, const juce::String& modelIdentity,
+                                double sampleRate)
+{
+    Hasher hasher;
+
+    const juce::int64 shape[] = { input.getNumChannels(), input.getNumSamples(), juce::roundToInt(sampleRate) };
+    hasher.addBytes(shape, sizeof(shape));
+    hasher.addBytes(modelIdentity.toRawUTF8(), modelIdentity.getNumBytesAsUTF8());
+
+    for (int ch = 0; ch < input.getNumChannels(); ++ch)
+        hasher.addBytes(input.getReadPointer(ch), static_cast<size_t>(input.getNumSamples()) * sizeof(float));
+
+    return hasher.toString();
+}
+
+juce::File StemCache::getFileForKey(const juce::String& key) const
+{
+    return directory.getChildFile(key + ".stems");
+}
+
+StemCache::EntryPtr StemCache::find(const juce::String& key) const
+{
+    const auto file = getFileForKey(key);
+
+    if (!file.existsAsFile())
+        return nullptr;
+
+    auto entry = std::make_shared<const Entry>(file);
+
+    if (!entry->isValid())
+        return nullptr;
+
+    // Recently used entries survive trim()
+    file.setLastAccessTime(juce::Time::getCurrentTime());
+    return entry;
+}
+
+bool StemCache::store(const juce::String& key, const std::array<juce::AudioBuffer<float>, 4>& stems,
+                      double sampleRate) const
+{
+    const int numChannels = stems[0].getNumChannels();
+    const int numSamples = stems[0].getNumSamples();
+
+    for (const auto& stem : stems)
+    {
+        if (stem.getNumChannels() != numChannels || stem.getNumSamples() != numSamples)
+            return false;
+    }
+
+    if (numChannels == 0 || numSamples == 0 || !directory.createDirectory())
+        return false;
+
+    const auto target = getFileForKey(key);
+    juce::TemporaryFile temporary(target);
+
+    {
+        auto stream = temporary.getFile().createOutputStream();
+
+        if (stream == nullptr)
+            return false;
+
+        FileHeader header {};
+        header.magic = fileMagic;
+        header.version = fileVersion;
+        header.numStems = 4;
+        header.numChannels = static_cast<juce::uint32>(numChannels);
+        header.numSamples = numSamples;
+        header.sampleRate = sampleRate;
+
+        bool ok = stream->write(&header, sizeof(header));
+
+        for (const auto& stem : stems)
+        {
+            for (int ch = 0; ch < numChannels && ok; ++ch)
+                ok = stream->write(stem.getReadPointer(ch), static_cast<size_t>(numSamples) * sizeof(float));
+        }
+
+        stream->flush();
+
+        if (!ok || stream->getStatus().failed())
+            return false;
+    }
+
+    if (!temporary.overwriteTargetFileWithTemporary())
+        return false;
+
+    trim();
+    return true;
+}
+
+void StemCache::trim() const
+{
+    auto files = directory.findChildFiles(juce::File::findFiles, false, "*.stems");
+
+    juce::int64 totalBytes = 0;
+
+    for (const auto& file : files)
+        totalBytes += file.getSize();
+
+    if (totalBytes <= maxSizeBytes)
+        return;
+
+    // Least recently used first. On POSIX a mapped entry can be deleted and
+    // stays readable; on Windows the delete fails while an instance has the
+    // entry mapped, so it is skipped, still counts, and is tried again by the
+    // next trim
+    std::sort(files.begin(), files.end(), [] (const juce::File& x, const juce::File& y)
+    {
+        return x.getLastAccessTime() < y.getLastAccessTime();
+    });
+
+    for (const auto& file : files)
+    {
+        if (totalBytes <= maxSizeBytes)
+            break;
+
+        const auto size = file.getSize();
+
+        if (!file.deleteFile())
+            continue;
+
+        totalBytes -= size;
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Persistent cache of separated stems, shared by every instance and the batch
+// tool. Entries are keyed by a hash of the input audio, the model identity and
+// the sample rate, and stored as raw planar float32 so a hit is memory-mapped
+// and read in place instead of being decoded or separated again.
+//
+// File layout (native byte order): a 64-byte header, then for each stem each
+// channel's samples back to back. Entries are written to a temporary file and
+// moved into place, so concurrent writers and readers never see half a file.
+class StemCache
+{
+public:
+    // A cached set of stems. The buffers point into the read-only mapping and
+    // stay valid for the life of the entry; never write to them.
+    class Entry
+    {
+    public:
+        explicit Entry(const juce::File& file);
+
+        bool isValid() const noexcept { return valid; }
+        const std::array<juce::AudioBuffer<float>, 4>& getStems() const noexcept { return stems; }
+        double getSampleRate() const noexcept { return sampleRate; }
+
+    private:
+        juce::MemoryMappedFile mappedFile;
+        std::array<juce::AudioBuffer<float>, 4> stems;
+        double sampleRate = 0.0;
+        bool valid = false;
+
+        JUCE_DECLARE_NON_COPYABLE(Entry)
+    };
+
+    using EntryPtr = std::shared_ptr<const Entry>;
+
+    explicit StemCache(const juce::File& directoryToUse = getDefaultDirectory());
+
+    static juce::File getDefaultDirectory();
+
+    // Not cryptographic; 128 bits so unrelated inputs never collide in practice
+    static juce::String makeKey(const juce::AudioBuffer<float>& input, const juce::String& modelIdentity,
+                                double sampleRate);
+
+    // nullptr on a miss or an unreadable entry
+    EntryPtr find(const juce::String& key) const;
+
+    // Writes the stems, then trims the oldest entries beyond the size limit
+    bool store(const juce::String& key, const std::array<juce::AudioBuffer<float>, 4>& stems,
+               double sampleRate) const;
+
+    void setMaxSizeBytes(juce::int64 bytes) { maxSizeBytes = bytes; }
+
+private:
+    juce::File getFileForKey(const juce::String& key) const;
+    void trim() const;
+
+    juce::File directory;
+    juce::int64 maxSizeBytes = juce::int64(2) << 30;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemCache)
+};
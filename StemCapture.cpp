@@ -0,0 +1,373 @@
+#include "StemCapture.h"
+
+namespace
+{
+    // Refinement granularity: each chunk is spliced in and republished on its own
+    constexpr double refineChunkSeconds = 2.0;
+    constexpr int crossfadeSamples = 1024;
+}
+
+//==============================================================================
+class StemCapture::Worker : public juce::Thread
+{
+public:
+    explicit Worker(StemCapture& ownerToUse)
+        : juce::Thread("Stem Capture"), owner(ownerToUse)
+    {
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.processTake();
+            wait(20);
+        }
+    }
+
+private:
+    StemCapture& owner;
+};
+
+//==============================================================================
+StemCapture::StemCapture(SamplerComponent& samplerToFeed)
+    : sampler(samplerToFeed)
+{
+}
+
+StemCapture::~StemCapture()
+{
+    if (worker)
+    {
+        // An offline separation in progress can take a while to finish
+        worker->stopThread(10000);
+    }
+}
+
+void StemCapture::prepare(double sampleRate)
+{
+    if (worker)
+    {
+        worker->stopThread(10000);
+    }
+
+    currentSampleRate = sampleRate;
+
+    // The worker has nothing else to do while a take records, so a second of
+    // ring is plenty
+    const int ringSize = static_cast<int>(sampleRate) + 1;
+    ring.setSize(2, ringSize);
+    ringFifo.setTotalSize(ringSize);
+    ringFifo.reset();
+
+    take.setSize(2, static_cast<int>(maxCaptureSeconds * sampleRate));
+    takePosition = 0;
+    samplesToCapture = 0;
+    droppedSamples = 0;
+    refining = false;
+    busy = false;
+
+    if (!worker)
+    {
+        worker = std::make_unique<Worker>(*this);
+    }
+
+    worker->startThread();
+}
+
+void StemCapture::setModelQuality(int quality)
+{
+    separator.setModelQuality(quality);
+}
+
+bool StemCapture::startCapture(double seconds) noexcept
+{
+    if (busy.load() || ring.getNumSamples() == 0)
+        return false;
+
+    const int length = juce::jlimit(1, take.getNumSamples(), static_cast<int>(seconds * currentSampleRate));
+
+    samplesToCapture = length;
+    takeLength = length;
+    droppedSamples = 0;
+    busy = true;
+    return true;
+}
+
+void StemCapture::pushInput(const juce::AudioBuffer<float>& input) noexcept
+{
+    const int numInputChannels = input.getNumChannels();
+
+    if (samplesToCapture == 0 || numInputChannels == 0)
+        return;
+
+    const int numToWrite = juce::jmin(samplesToCapture, input.getNumSamples());
+    int start1, size1, start2, size2;
+    ringFifo.prepareToWrite(numToWrite, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        const int sourceChannel = juce::jmin(ch, numInputChannels - 1);
+
+        if (size1 > 0)
+            ring.copyFrom(ch, start1, input, sourceChannel, 0, size1);
+
+        if (size2 > 0)
+            ring.copyFrom(ch, start2, input, sourceChannel, size1, size2);
+    }
+
+    ringFifo.finishedWrite(size1 + size2);
+    samplesToCapture -= size1 + size2;
+
+    // The worker stalled for a second: a take with a hole in it is no use,
+    // so stop recording and let the worker abort it
+    if (size1 + size2 < numToWrite)
+    {
+        droppedSamples = numToWrite - (size1 + size2);
+        samplesToCapture = 0;
+    }
+}
+
+//==============================================================================
+void StemCapture::processTake()
+{
+    if (!busy.load())
+        return;
+
+    if (refining)
+    {
+        refineNextChunk();
+        return;
+    }
+
+    drainRing();
+
+    const int length = takeLength.load();
+
+    if (const int dropped = droppedSamples.load(); dropped > 0)
+    {
+        juce::Logger::writeToLog("Capture aborted: dropped " + juce::String(dropped) + " samples after "
+                                 + juce::String(takePosition) + " of " + juce::String(length));
+        takePosition = 0;
+        busy = false;
+        return;
+    }
+
+    if (takePosition < length)
+        return;
+
+    // Separate a view of the recorded part only
+    juce::AudioBuffer<float> recorded(take.getArrayOfWritePointers(), take.getNumChannels(), length);
+    const int quality = separator.getModelQuality();
+    const auto key = StemCache::makeKey(recorded, separator.getModelIdentity(quality), currentSampleRate);
+
+    if (auto cached = cache.find(key))
+    {
+        // Played straight from the mapped cache file
+        sampler.loadSharedStems(cached->getStems(), cached->getSampleRate(), cached);
+        juce::Logger::writeToLog("Captured " + juce::String(length) + " samples, stems found in cache");
+    }
+    else if (progressive.load() && quality != StemSeparator::previewQuality)
+    {
+        // The take stays in the take buffer until refinement has finished
+        startRefinement(recorded, key, quality);
+        return;
+    }
+    else
+    {
+        std::array<juce::AudioBuffer<float>, 4> stems;
+        separator.separateOffline(recorded, static_cast<int>(currentSampleRate), stems, quality);
+
+        cache.store(key, stems, currentSampleRate);
+        sampler.loadStems(std::move(stems), currentSampleRate);
+
+        juce::Logger::writeToLog("Captured and separated " + juce::String(length) + " samples");
+    }
+
+    takePosition = 0;
+    busy = false;
+}
+
+void StemCapture::drainRing()
+{
+    int start1, size1, start2, size2;
+    ringFifo.prepareToRead(ringFifo.getNumReady(), start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch)
+    {
+        if (size1 > 0)
+            take.copyFrom(ch, takePosition, ring, ch, start1, size1);
+
+        if (size2 > 0)
+            take.copyFrom(ch, takePosition + size1, ring, ch, start2, size2);
+    }
+
+    ringFifo.finishedRead(size1 + size2);
+    takePosition += size1 + size2;
+}
+
+//==============================================================================
+void StemCapture::startRefinement(const juce::AudioBuffer<float>& recorded, const juce::String& key, int quality)
+{
+    const int length = recorded.getNumSamples();
+
+    separator.separateOffline(recorded, static_cast<int>(currentSampleRate), preview, StemSeparator::previewQuality);
+
+    std::array<juce::AudioBuffer<float>, 4> stems;
+
+    for (size_t i = 0; i < stems.size(); ++i)
+    {
+        stems[i].makeCopyOf(preview[i]);
+        blended[i].makeCopyOf(preview[i]);
+        refined[i].setSize(2, length);
+        refined[i].clear();
+    }
+
+    sampler.loadStems(std::move(stems), currentSampleRate);
+    juce::Logger::writeToLog("Captured " + juce::String(length) + " samples, playing preview while refining");
+
+    // The last chunk takes the remainder, so no chunk is shorter than chunkLength
+    chunkLength = juce::jmax(1, static_cast<int>(refineChunkSeconds * currentSampleRate));
+    chunkRefined.assign(static_cast<size_t>(juce::jmax(1, length / chunkLength)), false);
+    chunksRemaining = static_cast<int>(chunkRefined.size());
+
+    refineKey = key;
+    refineQuality = quality;
+    refining = true;
+}
+
+void StemCapture::refineNextChunk()
+{
+    const int length = takeLength.load();
+    juce::AudioBuffer<float> recorded(take.getArrayOfWritePointers(), take.getNumChannels(), length);
+
+    const int chunk = getNextChunk();
+    const int start = chunk * chunkLength;
+    const int end = chunk + 1 == static_cast<int>(chunkRefined.size()) ? length : start + chunkLength;
+
+    separator.separateOfflineRange(recorded, static_cast<int>(currentSampleRate), refined, start, end - start, refineQuality);
+    chunkRefined[static_cast<size_t>(chunk)] = true;
+
+    // Only the spliced samples change in the sampler, so the region the user
+    // has set on the take stays as it is
+    int spliceStart = 0, spliceEnd = 0;
+    spliceChunk(chunk, spliceStart, spliceEnd);
+    sampler.spliceStems(blended, spliceStart, spliceEnd - spliceStart);
+
+    if (--chunksRemaining > 0)
+        return;
+
+    // Fully refined: blended now is exactly what a one-pass separation would
+    // have produced
+    cache.store(refineKey, refined, currentSampleRate);
+
+    for (auto* set : { &preview, &refined, &blended })
+    {
+        for (auto& stem : *set)
+            stem.setSize(0, 0);
+    }
+
+    juce::Logger::writeToLog("Refined " + juce::String(length) + " samples");
+
+    refining = false;
+    takePosition = 0;
+    busy = false;
+}
+
+int StemCapture::getNextChunk() const
+{
+    const int numChunks = static_cast<int>(chunkRefined.size());
+
+    std::array<double, SamplerComponent::maxPlaybackPositions> positions;
+    const int numPositions = sampler.getPlaybackPositions(positions);
+
+    // Nothing to go by: in take order
+    if (numPositions == 0)
+    {
+        const auto next = std::find(chunkRefined.begin(), chunkRefined.end(), false);
+        return static_cast<int>(std::distance(chunkRefined.begin(), next));
+    }
+
+    // Nearest to a region start or voice first. Voices only move forward, so
+    // chunks behind a position are only heard from it after a new note or a
+    // loop, and count double.
+    const int length = takeLength.load();
+    int best = -1;
+    juce::int64 bestDistance = 0;
+
+    for (int chunk = 0; chunk < numChunks; ++chunk)
+    {
+        if (chunkRefined[static_cast<size_t>(chunk)])
+            continue;
+
+        const juce::int64 start = static_cast<juce::int64>(chunk) * chunkLength;
+        const juce::int64 end = chunk + 1 == numChunks ? length : start + chunkLength;
+
+        for (int i = 0; i < numPositions; ++i)
+        {
+            const auto position = static_cast<juce::int64>(positions[static_cast<size_t>(i)] * currentSampleRate);
+            const juce::int64 distance = position < start ? start - position
+                                       : position >= end ? 2 * (position - end + 1)
+                                       : 0;
+
+            if (best < 0 || distance < bestDistance)
+            {
+                best = chunk;
+                bestDistance = distance;
+            }
+        }
+    }
+
+    return best;
+}
+
+void StemCapture::spliceChunk(int chunk, int& spliceStart, int& spliceEnd)
+{
+    const int numChunks = static_cast<int>(chunkRefined.size());
+    const int length = refined[0].getNumSamples();
+    const int start = chunk * chunkLength;
+    const int end = chunk + 1 == numChunks ? length : start + chunkLength;
+
+    // Next to a refined chunk the stems join exactly, so its fade towards this
+    // chunk is overwritten; next to the preview they crossfade
+    const int fade = juce::jmin(crossfadeSamples, chunkLength / 2);
+    const bool previewBefore = chunk > 0 && !chunkRefined[static_cast<size_t>(chunk - 1)];
+    const bool previewAfter = chunk + 1 < numChunks && !chunkRefined[static_cast<size_t>(chunk + 1)];
+    const bool refinedBefore = chunk > 0 && !previewBefore;
+    const bool refinedAfter = chunk + 1 < numChunks && !previewAfter;
+
+    const int copyStart = previewBefore ? start + fade : (refinedBefore ? start - fade : start);
+    const int copyEnd = previewAfter ? end - fade : (refinedAfter ? end + fade : end);
+
+    // blended = preview + weight * (refined - preview), weight ramping linearly
+    auto crossfade = [this] (int from, int numSamples, float startWeight, float step)
+    {
+        for (size_t i = 0; i < blended.size(); ++i)
+        {
+            for (int ch = 0; ch < 2; ++ch)
+            {
+                const float* p = preview[i].getReadPointer(ch, from);
+                const float* r = refined[i].getReadPointer(ch, from);
+                float* dest = blended[i].getWritePointer(ch, from);
+
+                for (int n = 0; n < numSamples; ++n)
+                    dest[n] = p[n] + (startWeight + step * static_cast<float>(n)) * (r[n] - p[n]);
+            }
+        }
+    };
+
+    if (previewBefore)
+        crossfade(start, fade, 0.0f, 1.0f / static_cast<float>(fade));
+
+    if (previewAfter)
+        crossfade(end - fade, fade, 1.0f, -1.0f / static_cast<float>(fade));
+
+    for (size_t i = 0; i < blended.size(); ++i)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+            blended[i].copyFrom(ch, copyStart, refined[i], ch, copyStart, copyEnd - copyStart);
+    }
+
+    spliceStart = juce::jmin(start, copyStart);
+    spliceEnd = juce::jmax(end, copyEnd);
+}
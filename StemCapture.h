@@ -0,0 +1,86 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StemSeparator.h"
+#include "SamplerComponent.h"
+#include "StemCache.h"
+
+// Records a take of the input and separates it into the sampler in the
+// background. The audio thread only writes into a lock-free ring; a worker
+// thread drains it into the take buffer, runs the offline separation once the
+// take is complete and hands the stems to the sampler, which swaps them in
+// without interrupting playback. Takes that were separated before (in any
+// session) come straight from the StemCache instead.
+//
+// In progressive mode the take is first separated with the light preview
+// model, so it can be played almost at once, and then refined with the
+// selected model a chunk at a time. Each refined chunk is spliced into the
+// sampler's stems with short crossfades against the preview around it.
+// Chunks are refined in order of distance from where the sampler plays the
+// take (the region starts and the sounding voices), so the part about to be
+// heard is refined first; the order follows the voices as they move.
+class StemCapture
+{
+public:
+    static constexpr double maxCaptureSeconds = 30.0;
+
+    explicit StemCapture(SamplerComponent& samplerToFeed);
+    ~StemCapture();
+
+    // Allocates the ring and take buffer and starts the worker
+    void prepare(double sampleRate);
+
+    void setModelQuality(int quality);
+    void setProgressive(bool shouldBeProgressive) noexcept { progressive = shouldBeProgressive; }
+
+    // Audio thread. startCapture() returns false while the previous take is
+    // still being recorded, separated or refined.
+    bool startCapture(double seconds) noexcept;
+    void pushInput(const juce::AudioBuffer<float>& input) noexcept;
+
+    bool isBusy() const noexcept { return busy.load(); }
+
+private:
+    class Worker;
+
+    // Worker thread
+    void processTake();
+    void drainRing();
+    void startRefinement(const juce::AudioBuffer<float>& recorded, const juce::String& key, int quality);
+    void refineNextChunk();
+    int getNextChunk() const;
+    void spliceChunk(int chunk, int& spliceStart, int& spliceEnd); // returns the samples of blended it changed
+
+    SamplerComponent& sampler;
+    StemSeparator separator; // offline use only, separate from the realtime one
+    StemCache cache;
+    double currentSampleRate = 44100.0;
+
+    // Audio thread -> worker: about a second of headroom. If it overflows the
+    // take is aborted rather than recorded with a gap.
+    juce::AbstractFifo ringFifo { 1 };
+    juce::AudioBuffer<float> ring;
+    int samplesToCapture = 0; // audio thread only
+    std::atomic<int> takeLength { 0 };
+    std::atomic<bool> busy { false };
+    std::atomic<bool> progressive { true };
+    std::atomic<int> droppedSamples { 0 };
+
+    // Worker only
+    juce::AudioBuffer<float> take;
+    int takePosition = 0;
+
+    // Progressive refinement of the current take (worker only): the preview,
+    // the refined stems so far and the blend of both handed to the sampler
+    bool refining = false;
+    juce::String refineKey;
+    int refineQuality = 0;
+    std::array<juce::AudioBuffer<float>, 4> preview, refined, blended;
+    std::vector<bool> chunkRefined;
+    int chunkLength = 0;
+    int chunksRemaining = 0;
+
+    std::unique_ptr<Worker> worker;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemCapture)
+};
@@ -0,0 +1,138 @@
+#include "StemFilterBank.h"
+
+StemFilterBank::StemFilterBank()
+{
+    prepare(currentSampleRate);
+}
+
+void StemFilterBank::prepare(double sampleRate)
+{
+    currentSampleRate = sampleRate;
+
+    for (int stem = 0; stem < numStems; ++stem)
+    {
+        frequencySmooth[stem].reset(sampleRate, 0.01);
+        resonanceSmooth[stem].reset(sampleRate, 0.01);
+        frequencySmooth[stem].setCurrentAndTargetValue(20000.0f);
+        resonanceSmooth[stem].setCurrentAndTargetValue(0.1f);
+
+        // Forces the first updateCoefficients() to compute every stem
+        cachedFrequency[stem] = -1.0f;
+        cachedResonance[stem] = -1.0f;
+    }
+
+    reset();
+    updateCoefficients(0);
+}
+
+void StemFilterBank::reset() noexcept
+{
+    std::fill(std::begin(ic1eq), std::end(ic1eq), 0.0f);
+    std::fill(std::begin(ic2eq), std::end(ic2eq), 0.0f);
+}
+
+void StemFilterBank::setParameters(int stemIndex, float frequency, float resonance) noexcept
+{
+    if (stemIndex < 0 || stemIndex >= numStems)
+        return;
+
+    frequencySmooth[stemIndex].setTargetValue(juce::jlimit(20.0f, 20000.0f, frequency));
+    resonanceSmooth[stemIndex].setTargetValue(juce::jlimit(0.1f, 10.0f, resonance));
+}
+
+void StemFilterBank::updateCoefficients(int numSamplesToAdvance) noexcept
+{
+    for (int stem = 0; stem < numStems; ++stem)
+    {
+        // One smoother per stem, so both channels always share a cutoff
+        const float frequency = numSamplesToAdvance > 0 ? frequencySmooth[stem].skip(numSamplesToAdvance)
+                                                        : frequencySmooth[stem].getCurrentValue();
+        const float resonance = numSamplesToAdvance > 0 ? resonanceSmooth[stem].skip(numSamplesToAdvance)
+                                                        : resonanceSmooth[stem].getCurrentValue();
+
+        if (frequency == cachedFrequency[stem] && resonance == cachedResonance[stem])
+            continue;
+
+        cachedFrequency[stem] = frequency;
+        cachedResonance[stem] = resonance;
+
+        // Fully open passes the bus through untouched, as before
+        const float dryMix = frequency >= 20000.0f ? 1.0f : 0.0f;
+
+        const double cutoff = juce::jmin(static_cast<double>(frequency), 0.49 * currentSampleRate);
+        const double g = std::tan(juce::MathConstants<double>::pi * cutoff / currentSampleRate);
+        const double k = 1.0 / (juce::MathConstants<double>::sqrt2 * 0.5 * (1.0 + resonance)); // 1 / Q
+
+        const double c1 = 1.0 / (1.0 + g * (g + k));
+        const double c2 = g * c1;
+        const double c3 = g * c2;
+
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const int slot = ch * numStems + stem;
+            a1[slot] = static_cast<float>(c1);
+            a2[slot] = static_cast<float>(c2);
+            a3[slot] = static_cast<float>(c3);
+            dry[slot] = dryMix;
+        }
+    }
+}
+
+void StemFilterBank::process(juce::AudioBuffer<float>& buses, int numSamples) noexcept
+{
+    jassert(buses.getNumChannels() >= numSlots);
+
+    float* channels[paddedSlots] {};
+
+    for (int slot = 0; slot < numSlots; ++slot)
+        channels[slot] = buses.getWritePointer((slot % numStems) * 2 + slot / numStems);
+
+    alignas(Vec::SIMDNumBytes) float input[paddedSlots] {};
+    alignas(Vec::SIMDNumBytes) float output[paddedSlots] {};
+
+    for (int start = 0; start < numSamples; start += controlInterval)
+    {
+        const int blockLength = juce::jmin(controlInterval, numSamples - start);
+        updateCoefficients(blockLength);
+
+        Vec c1[numGroups], c2[numGroups], c3[numGroups], mix[numGroups], s1[numGroups], s2[numGroups];
+
+        for (int g = 0; g < numGroups; ++g)
+        {
+            c1[g] = Vec::fromRawArray(a1 + g * lanes);
+            c2[g] = Vec::fromRawArray(a2 + g * lanes);
+            c3[g] = Vec::fromRawArray(a3 + g * lanes);
+            mix[g] = Vec::fromRawArray(dry + g * lanes);
+            s1[g] = Vec::fromRawArray(ic1eq + g * lanes);
+            s2[g] = Vec::fromRawArray(ic2eq + g * lanes);
+        }
+
+        for (int i = start; i < start + blockLength; ++i)
+        {
+            for (int slot = 0; slot < numSlots; ++slot)
+                input[slot] = channels[slot][i];
+
+            for (int g = 0; g < numGroups; ++g)
+            {
+                const auto v0 = Vec::fromRawArray(input + g * lanes);
+                const auto v3 = v0 - s2[g];
+                const auto v1 = c1[g] * s1[g] + c2[g] * v3;
+                const auto v2 = s2[g] + c2[g] * s1[g] + c3[g] * v3;
+
+                s1[g] = v1 * 2.0f - s1[g];
+                s2[g] = v2 * 2.0f - s2[g];
+
+                (v2 + mix[g] * (v0 - v2)).copyToRawArray(output + g * lanes);
+            }
+
+            for (int slot = 0; slot < numSlots; ++slot)
+                channels[slot][i] = output[slot];
+        }
+
+        for (int g = 0; g < numGroups; ++g)
+        {
+            s1[g].copyToRawArray(ic1eq + g * lanes);
+            s2[g].copyToRawArray(ic2eq + g * lanes);
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Low-pass filters for the sampler's four stereo stem buses, run together:
+// the eight filters (4 stems x 2 channels) sit in SIMDRegister lanes and share
+// one pass over the block. Each is a TPT state-variable filter whose
+// coefficients are recomputed once per controlInterval samples from smoothed
+// frequency/resonance, and only when those have moved.
+class StemFilterBank
+{
+public:
+    static constexpr int numStems = 4;
+    static constexpr int controlInterval = 32;
+
+    StemFilterBank();
+
+    void prepare(double sampleRate);
+    void reset() noexcept;
+
+    // Cutoff in Hz (20000 = open) and resonance 0.1-10
+    void setParameters(int stemIndex, float frequency, float resonance) noexcept;
+
+    // Filters channels stem * 2 + {0, 1} of buses in place
+    void process(juce::AudioBuffer<float>& buses, int numSamples) noexcept;
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+
+    static constexpr int numSlots = numStems * 2; // slot = channel * numStems + stem
+    static constexpr int lanes = static_cast<int>(Vec::SIMDNumElements);
+    static constexpr int numGroups = (numSlots + lanes - 1) / lanes;
+    static constexpr int paddedSlots = numGroups * lanes;
+
+    void updateCoefficients(int numSamplesToAdvance) noexcept;
+
+    double currentSampleRate = 44100.0;
+
+    juce::SmoothedValue<float> frequencySmooth[numStems];
+    juce::SmoothedValue<float> resonanceSmooth[numStems];
+    float cachedFrequency[numStems] {};
+    float cachedResonance[numStems] {};
+
+    // Per-slot coefficients and state, laid out for direct SIMD loads
+    alignas(Vec::SIMDNumBytes) float a1[paddedSlots] {};
+    alignas(Vec::SIMDNumBytes) float a2[paddedSlots] {};
+    alignas(Vec::SIMDNumBytes) float a3[paddedSlots] {};
+    alignas(Vec::SIMDNumBytes) float dry[paddedSlots] {};
+    alignas(Vec::SIMDNumBytes) float ic1eq[paddedSlots] {};
+    alignas(Vec::SIMDNumBytes) float ic2eq[paddedSlots] {};
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemFilterBank)
+};
@@ -0,0 +1,228 @@
+#include "StemMipMap.h"
+
+namespace
+{
+    // Kaiser-windowed sinc low-pass: flat to 0.2 of the input rate, at least
+    // 90 dB down from 0.25 (the new Nyquist) on, so nothing folds back into a
+    // decimated level. Zero phase, so every level lines up with level 0.
+    constexpr int decimationHalfLength = 64;
+    constexpr int decimationTaps = 2 * decimationHalfLength + 1;
+
+    // Below this a level is not worth having
+    constexpr int minLevelLength = 64;
+
+    // Zeroth-order modified Bessel function of the first kind
+    double besselI0(double x)
+    {
+        double sum = 1.0, term = 1.0;
+
+        for (int k = 1; k < 50; ++k)
+        {
+            term *= (x / (2.0 * k)) * (x / (2.0 * k));
+            sum += term;
+        }
+
+        return sum;
+    }
+
+    std::array<float, decimationTaps> makeDecimationFilter()
+    {
+        std::array<float, decimationTaps> taps {};
+        constexpr double cutoff = 0.225; // middle of the 0.2-0.25 transition band
+        constexpr double beta = 8.96;    // Kaiser beta for 90 dB
+        double sum = 0.0;
+
+        for (int j = -decimationHalfLength; j <= decimationHalfLength; ++j)
+        {
+            const double px = juce::MathConstants<double>::twoPi * cutoff * j;
+            const double sinc = j == 0 ? 1.0 : std::sin(px) / px;
+
+            const double r = static_cast<double>(j) / decimationHalfLength;
+            const double window = besselI0(beta * std::sqrt(1.0 - r * r)) / besselI0(beta);
+
+            taps[static_cast<size_t>(j + decimationHalfLength)] = static_cast<float>(sinc * window);
+            sum += sinc * window;
+        }
+
+        for (auto& tap : taps)
+            tap = static_cast<float>(tap / sum);
+
+        return taps;
+    }
+
+    // Decimates samples [outputStart, outputEnd) of the next level. input holds
+    // samples from inputStart on of a level inputLength samples long, enough of
+    // them to cover every tap.
+    void decimateRange(const juce::AudioBuffer<float>& input, int inputStart, int inputLength,
+                       juce::AudioBuffer<float>& output, int outputStart, int outputEnd)
+    {
+        static const auto taps = makeDecimationFilter();
+
+        output.setSize(input.getNumChannels(), outputEnd - outputStart);
+
+        for (int ch = 0; ch < input.getNumChannels(); ++ch)
+        {
+            const auto* in = input.getReadPointer(ch) - inputStart;
+            auto* out = output.getWritePointer(ch) - outputStart;
+
+            for (int n = outputStart; n < outputEnd; ++n)
+            {
+                const int centre = 2 * n;
+                float sum = 0.0f;
+
+                if (centre - decimationHalfLength >= 0 && centre + decimationHalfLength < inputLength)
+                {
+                    jassert(centre - decimationHalfLength >= inputStart
+                             && centre + decimationHalfLength < inputStart + input.getNumSamples());
+
+                    const auto* x = in + centre - decimationHalfLength;
+
+                    for (int j = 0; j < decimationTaps; ++j)
+                        sum += taps[static_cast<size_t>(j)] * x[j];
+                }
+                else
+                {
+                    // Hold the edge samples
+                    for (int j = 0; j < decimationTaps; ++j)
+                    {
+                        const int index = juce::jlimit(0, inputLength - 1, centre - decimationHalfLength + j);
+                        sum += taps[static_cast<size_t>(j)] * in[index];
+                    }
+                }
+
+                out[n] = sum;
+            }
+        }
+    }
+
+    void decimate(const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& output)
+    {
+        const int inputLength = input.getNumSamples();
+        decimateRange(input, 0, inputLength, output, 0, (inputLength + 1) / 2);
+    }
+}
+
+//==============================================================================
+void StemMipMap::build(const juce::AudioBuffer<float>& stem, StemStorage::Format format)
+{
+    levels.clear();
+
+    // Each level is decimated from the full-precision one above it
+    juce::AudioBuffer<float> previous, current;
+    const juce::AudioBuffer<float>* input = &stem;
+
+    while (static_cast<int>(levels.size()) < maxLevels
+           && input->getNumChannels() > 0
+           && input->getNumSamples() / 2 >= minLevelLength)
+    {
+        decimate(*input, current);
+
+        levels.push_back(std::make_unique<StemStorage>());
+        levels.back()->setFrom(current, format);
+
+        std::swap(previous, current);
+        input = &previous;
+    }
+}
+
+void StemMipMap::makeCopyOf(const StemMipMap& other)
+{
+    levels.clear();
+
+    for (const auto& level : other.levels)
+    {
+        levels.push_back(std::make_unique<StemStorage>());
+        levels.back()->makeCopyOf(*level);
+    }
+}
+
+int StemMipMap::getSpans(int stemLength, int startSample, int endSample, Spans& changed, Spans& needed)
+{
+    // A level sample reads taps from 2n - halfLength to 2n + halfLength of the
+    // level above, clamped to that level
+    std::array<int, maxLevels + 1> lengths {};
+    lengths[0] = stemLength;
+    int numLevels = 0;
+
+    while (numLevels < maxLevels && lengths[static_cast<size_t>(numLevels)] / 2 >= minLevelLength)
+    {
+        lengths[static_cast<size_t>(numLevels + 1)] = (lengths[static_cast<size_t>(numLevels)] + 1) / 2;
+        ++numLevels;
+    }
+
+    // Each level is rewritten in whole int16 blocks, which then encode
+    // exactly as build() would
+    StemStorage::alignToBlocks(stemLength, startSample, endSample);
+    changed[0] = { startSample, endSample };
+
+    for (int k = 1; k <= numLevels; ++k)
+    {
+        const auto& above = changed[static_cast<size_t>(k - 1)];
+        int first = juce::jmax(0, (above.first - decimationHalfLength + 1) / 2);
+        int last = juce::jmin(lengths[static_cast<size_t>(k)], (above.second - 1 + decimationHalfLength) / 2 + 1);
+        StemStorage::alignToBlocks(lengths[static_cast<size_t>(k)], first, last);
+        changed[static_cast<size_t>(k)] = { first, juce::jmax(first, last) };
+    }
+
+    // Every changed sample of a level is recomputed from the samples its taps
+    // cover in the level above, so those must be recomputed too
+    needed[static_cast<size_t>(numLevels)] = changed[static_cast<size_t>(numLevels)];
+
+    for (int k = numLevels; k > 0; --k)
+    {
+        const auto& below = needed[static_cast<size_t>(k)];
+        const auto& own = changed[static_cast<size_t>(k - 1)];
+        const int first = juce::jmax(0, 2 * below.first - decimationHalfLength);
+        const int last = juce::jmin(lengths[static_cast<size_t>(k - 1)], 2 * (below.second - 1) + decimationHalfLength + 1);
+        needed[static_cast<size_t>(k - 1)] = { juce::jmin(first, own.first), juce::jmax(last, own.second) };
+    }
+
+    return numLevels;
+}
+
+void StemMipMap::getRebuildSource(int stemLength, int startSample, int endSample, int& sourceStart, int& sourceEnd)
+{
+    Spans changed, needed;
+    getSpans(stemLength, startSample, endSample, changed, needed);
+    sourceStart = needed[0].first;
+    sourceEnd = needed[0].second;
+}
+
+void StemMipMap::rebuild(const juce::AudioBuffer<float>& source, int sourceStart, int stemLength, int startSample, int endSample)
+{
+    Spans changed, needed;
+    const int numLevels = juce::jmin(getSpans(stemLength, startSample, endSample, changed, needed), getNumLevels());
+
+    jassert(sourceStart <= needed[0].first && needed[0].second <= sourceStart + source.getNumSamples());
+
+    // Same arithmetic as build() over whole blocks, so the rebuilt levels come
+    // out identical in every storage format
+    juce::AudioBuffer<float> previous, current;
+    const juce::AudioBuffer<float>* input = &source;
+    int inputStart = sourceStart;
+    int inputLength = stemLength;
+
+    for (int k = 1; k <= numLevels; ++k)
+    {
+        const auto& span = needed[static_cast<size_t>(k)];
+        const auto& write = changed[static_cast<size_t>(k)];
+        decimateRange(*input, inputStart, inputLength, current, span.first, span.second);
+
+        levels[static_cast<size_t>(k - 1)]->write(current, write.first - span.first, write.first, write.second - write.first);
+
+        std::swap(previous, current);
+        input = &previous;
+        inputStart = span.first;
+        inputLength = (inputLength + 1) / 2;
+    }
+}
+
+int StemMipMap::chooseLevel(double increment) const noexcept
+{
+    int level = 0;
+
+    while (level < getNumLevels() && increment > static_cast<double>(1 << level))
+        ++level;
+
+    return level;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StemStorage.h"
+
+// Band-limited, decimated copies of a stem for fast pitched-up playback.
+// Level k holds the stem low-passed and decimated by 2^k, so a voice playing
+// at increment r reads level chooseLevel(r) at increment r / 2^k and never
+// needs a kernel wider than unity-rate playback does.
+//
+// Level 0 is the stem itself and stays with the sampler; this object owns
+// levels 1..getNumLevels(). It is built off the audio thread with build()
+// and then only read.
+class StemMipMap
+{
+public:
+    static constexpr int maxLevels = 6;
+
+    StemMipMap() = default;
+
+    // Decimates the stem level by level and stores each level in the given
+    // format; slow
+    void build(const juce::AudioBuffer<float>& stem, StemStorage::Format format);
+
+    // Copies the levels of other, e.g. to rebuild() part of them
+    void makeCopyOf(const StemMipMap& other);
+
+    // After samples [startSample, endSample) of a stem stemLength samples long
+    // have changed, recomputes the level samples they reach, widened to whole
+    // int16 blocks so the result matches build(). source holds the new
+    // full-precision stem from sourceStart on and must cover the span
+    // getRebuildSource() returns; slow, but only in proportion to the change.
+    void rebuild(const juce::AudioBuffer<float>& source, int sourceStart, int stemLength, int startSample, int endSample);
+    static void getRebuildSource(int stemLength, int startSample, int endSample, int& sourceStart, int& sourceEnd);
+
+    int getNumLevels() const { return static_cast<int>(levels.size()); }
+    const StemStorage& getLevel(int level) const { return *levels[static_cast<size_t>(level - 1)]; }
+
+    // Smallest level read at no more than one of its samples per output sample,
+    // so everything it keeps stays below the output's Nyquist
+    int chooseLevel(double increment) const noexcept;
+
+private:
+    // Per level, [first, second) sample ranges
+    using Spans = std::array<std::pair<int, int>, maxLevels + 1>;
+
+    static int getSpans(int stemLength, int startSample, int endSample, Spans& changed, Spans& needed);
+
+    std::vector<std::unique_ptr<StemStorage>> levels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemMipMap)
+};
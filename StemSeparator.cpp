@@ -1,64 +1,370 @@
 #include "StemSeparator.h"
 #include "DemucsInterface.h"
 
+//==============================================================================
+// Loads models so neither the audio thread nor the inference pool waits on disk
+class StemSeparator::ModelLoader : public juce::Thread
+{
+public:
+    explicit ModelLoader(StemSeparator& ownerToUse)
+        : juce::Thread("Demucs Model Loader"), owner(ownerToUse)
+    {
+    }
+
+    void run() override
+    {
+        while (!threadShouldExit())
+        {
+            owner.loadRequestedModel();
+            wait(20);
+        }
+    }
+
+private:
+    StemSeparator& owner;
+};
+
+//==============================================================================
+namespace
+{
+    const char* getModelPath(int quality)
+    {
+        switch (quality)
+        {
+            case 0: return "models/demucs_light.th";
+            case 1: return "models/demucs.th";
+            case 2: return "models/htdemucs.th";
+            case 3: return "models/htdemucs_6s.th";
+            default: return "models/htdemucs.th";
+        }
+    }
+
+    // dest[i] = sum over stems of (gain + i * step) * stem[i]; a single pass the
+    // compiler can vectorise, used by the live remix path
+    void mixRampedStems(float* dest, const std::array<const float*, 4>& stems,
+                        const std::array<float, 4>& gains, const std::array<float, 4>& steps, int numSamples)
+    {
+        const float* s0 = stems[0];
+        const float* s1 = stems[1];
+        const float* s2 = stems[2];
+        const float* s3 = stems[3];
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto t = static_cast<float>(i);
+
+            dest[i] = (gains[0] + t * steps[0]) * s0[i]
+                    + (gains[1] + t * steps[1]) * s1[i]
+                    + (gains[2] + t * steps[2]) * s2[i]
+                    + (gains[3] + t * steps[3]) * s3[i];
+        }
+    }
+
+    // Mono downmix of the above: each stem contributes 0.5 * (left + right)
+    void mixRampedStemsMono(float* dest, const std::array<const float*, 4>& lefts, const std::array<const float*, 4>& rights,
+                            const std::array<float, 4>& gains, const std::array<float, 4>& steps, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto t = static_cast<float>(i);
+
+            dest[i] = 0.5f * ((gains[0] + t * steps[0]) * (lefts[0][i] + rights[0][i])
+                            + (gains[1] + t * steps[1]) * (lefts[1][i] + rights[1][i])
+                            + (gains[2] + t * steps[2]) * (lefts[2][i] + rights[2][i])
+                            + (gains[3] + t * steps[3]) * (lefts[3][i] + rights[3][i]));
+        }
+    }
+
+    void copyRamped(float* dest, const float* source, float gain, float step, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = (gain + static_cast<float>(i) * step) * source[i];
+    }
+
+    void copyRampedMono(float* dest, const float* left, const float* right, float gain, float step, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            dest[i] = 0.5f * (gain + static_cast<float>(i) * step) * (left[i] + right[i]);
+    }
+}
+
+//==============================================================================
+StemSeparator::LoadedModel::~LoadedModel()
+{
+    // The model may read from the weights, so it goes first
+    demucs_cleanup(model);
+}
+
 StemSeparator::StemSeparator()
 {
-    processingBuffer.setSize(2, 8192);
 }
 
 StemSeparator::~StemSeparator()
 {
-    if (demucsModel)
+    if (registeredWithScheduler)
+    {
+        inferenceScheduler->removeClient(this);
+    }
+
+    if (modelLoader)
     {
-        demucs_cleanup(demucsModel);
+        modelLoader->stopThread(2000);
     }
+
+    // No inference job can run any more, so its models can be freed here
+    for (auto* model : { demucsModel, fadingOutModel, retiringModel })
+        delete model;
+}
+
+void StemSeparator::setSegmentSettings(int segmentLengthSamples, float overlap)
+{
+    segmentLength = juce::jmax(256, segmentLengthSamples);
+    segmentOverlap = overlap;
 }
 
 void StemSeparator::initialize(int sampleRate, int bufferSize)
 {
+    if (registeredWithScheduler)
+    {
+        inferenceScheduler->removeClient(this);
+        registeredWithScheduler = false;
+    }
+
+    if (modelLoader)
+    {
+        modelLoader->stopThread(2000);
+    }
+
     currentSampleRate = sampleRate;
     currentBufferSize = bufferSize;
-    
-    // Initialize Demucs model
-    loadDemucsModel();
-    
+
+    // Nothing else is running: drop models loaded for the previous sample rate
+    // and load the first one here, outside the audio callback
+    for (auto* model : { demucsModel, fadingOutModel, retiringModel })
+        delete model;
+
+    demucsModel = fadingOutModel = retiringModel = nullptr;
+    loadedModelQuality = requestedModelQuality.load();
+    modelPublisher.publish(loadDemucsModel(loadedModelQuality, sampleRate));
+
+    segmentScheduler.prepare(segmentLength, segmentOverlap);
+    const int segmentSize = segmentScheduler.getSegmentLength();
+    const int hopSize = segmentScheduler.getHopSize();
+    const int priming = segmentScheduler.getPrimingSamples();
+
+    // The output ring leads by one hop to fill, one hop of inference headroom and
+    // two host blocks for the worker to pick up a hop that completes mid-block.
+    // Overlap-add then holds each hop back until its last segment has been seen.
+    const int outputLead = 2 * hopSize + 2 * bufferSize;
+    latencySamples = outputLead + priming;
+
+    const int ringSize = outputLead + segmentSize + 4 * bufferSize;
+    inputFifo.setTotalSize(ringSize);
+    inputRing.setSize(2, ringSize);
+    inputRing.clear();
+    outputFifo.setTotalSize(ringSize);
+    outputRing.setSize(numStemChannels, ringSize);
+    outputRing.clear();
+    outputDebt = 0;
+    staleSamples = 0;
+
+    // Prime the input with the overlap history of the first segment and
+    // pre-fill the output ring with the worker's lead
+    int start1, size1, start2, size2;
+    inputFifo.prepareToWrite(priming, start1, size1, start2, size2);
+    inputFifo.finishedWrite(size1 + size2);
+    outputFifo.prepareToWrite(outputLead, start1, size1, start2, size2);
+    outputFifo.finishedWrite(size1 + size2);
+
+    silenceGate.prepare(sampleRate, segmentSize, hopSize);
+    gateHistory.assign(static_cast<size_t>(segmentSize / hopSize), SilenceGate::State::closed);
+
+    // Loops up to STEMSPLITTER_MEMO_SECONDS are replayed; the history starts
+    // short and grows to the host's loop length
+    inferenceMemo.prepare(segmentSize, hopSize, STEMSPLITTER_MEMO_SECONDS * sampleRate);
+    memoHop.setSize(numStemChannels, hopSize);
+    segmentIndex = 0;
+    schedulerSkipped = false;
+    loopLengthHint = 0;
+    lastPlayheadEnd = -1;
+
+    // Crossfade from the outgoing to the incoming model over one segment
+    fadeOutStems.setSize(numStemChannels, segmentSize);
+    fadeInRamp.allocate(static_cast<size_t>(segmentSize), false);
+    fadeOutRamp.allocate(static_cast<size_t>(segmentSize), false);
+
+    for (int i = 0; i < segmentSize; ++i)
+    {
+        fadeInRamp[i] = static_cast<float>(i) / static_cast<float>(segmentSize);
+        fadeOutRamp[i] = 1.0f - fadeInRamp[i];
+    }
+
+    if (!modelLoader)
+    {
+        modelLoader = std::make_unique<ModelLoader>(*this);
+    }
+
+    modelLoader->startThread();
+    inferenceScheduler->addClient(this);
+    registeredWithScheduler = true;
     initialized = true;
 }
 
-void StemSeparator::loadDemucsModel()
+StemSeparator::ModelPtr StemSeparator::loadDemucsModel(int quality, int sampleRate)
 {
-    // Clean up existing model
-    if (demucsModel)
-    {
-        demucs_cleanup(demucsModel);
-        demucsModel = nullptr;
-    }
-    
     // Load Demucs model based on quality setting
-    const char* modelPath = nullptr;
-    
-    switch (modelQuality)
+    const char* modelPath = getModelPath(quality);
+
+    auto loaded = std::make_unique<LoadedModel>();
+
+    // Weights are mapped once per process and shared with every other instance
+    loaded->weights = modelRegistry->acquire(modelPath, sampleRate);
+
+    if (loaded->weights != nullptr)
     {
-        case 0: modelPath = "models/demucs_light.th"; break;
-        case 1: modelPath = "models/demucs.th"; break;
-        case 2: modelPath = "models/htdemucs.th"; break;
-        case 3: modelPath = "models/htdemucs_6s.th"; break;
-        default: modelPath = "models/htdemucs.th"; break;
+        loaded->model = demucs_load_model_from_memory(loaded->weights->getData(),
+                                                      loaded->weights->getSize(),
+                                                      sampleRate);
     }
-    
-    demucsModel = demucs_load_model(modelPath, currentSampleRate);
-    
-    if (!demucsModel)
+
+    if (!loaded->model)
     {
         // Fallback to basic separation if model fails to load
-        demucsModel = demucs_load_model(nullptr, currentSampleRate);
+        loaded->weights = nullptr;
+        loaded->model = demucs_load_model(nullptr, sampleRate);
+    }
+
+    return loaded;
+}
+
+void StemSeparator::loadRequestedModel()
+{
+    modelPublisher.collectGarbage();
+
+    const int quality = requestedModelQuality.load();
+
+    if (quality == loadedModelQuality)
+        return;
+
+    loadedModelQuality = quality;
+    modelPublisher.publish(loadDemucsModel(quality, currentSampleRate));
+}
+
+void StemSeparator::separateOffline(const juce::AudioBuffer<float>& input, int sampleRate,
+                                    std::array<juce::AudioBuffer<float>, 4>& stemOutputs, int quality)
+{
+    for (auto& stem : stemOutputs)
+    {
+        stem.setSize(2, input.getNumSamples());
+        stem.clear();
+    }
+
+    separateOfflineRange(input, sampleRate, stemOutputs, 0, input.getNumSamples(), quality);
+}
+
+void StemSeparator::separateOfflineRange(const juce::AudioBuffer<float>& input, int sampleRate,
+                                         std::array<juce::AudioBuffer<float>, 4>& stemOutputs,
+                                         int startSample, int numSamples, int quality)
+{
+    const int inputLength = input.getNumSamples();
+    const int numInputChannels = input.getNumChannels();
+
+    startSample = juce::jlimit(0, inputLength, startSample);
+    const int endSample = juce::jlimit(startSample, inputLength, startSample + numSamples);
+
+    if (endSample == startSample || numInputChannels == 0)
+        return;
+
+    for (auto& stem : stemOutputs)
+        jassert(stem.getNumChannels() >= 2 && stem.getNumSamples() >= inputLength);
+
+    auto* model = getOfflineModel(quality < 0 ? requestedModelQuality.load() : quality, sampleRate);
+
+    // Same segmentation as the realtime path, run straight over the buffer.
+    // The stream starts with the priming history, so hop m covers input
+    // samples from m * hopSize - priming.
+    SegmentScheduler scheduler;
+    scheduler.prepare(segmentLength, segmentOverlap);
+
+    const int segmentSize = scheduler.getSegmentLength();
+    const int hopSize = scheduler.getHopSize();
+    const int priming = scheduler.getPrimingSamples();
+    auto& segment = scheduler.getSegmentBuffer();
+
+    SilenceGate gate;
+    gate.prepare(sampleRate, segmentSize, hopSize);
+
+    // The first hop of the range, and the first segment overlapping it.
+    // Earlier segments only advance the gate, so that a range comes out
+    // exactly as it does from a whole-buffer pass.
+    const int firstHopPos = (startSample + priming) / hopSize * hopSize;
+    const int firstSegmentPos = firstHopPos - priming;
+
+    for (int streamPos = 0; streamPos - priming < endSample; streamPos += hopSize)
+    {
+        // Copy the segment, zero-padded outside the input
+        const int inputStart = streamPos - priming;
+        const int first = juce::jlimit(0, segmentSize, -inputStart);
+        const int last = juce::jlimit(0, segmentSize, inputLength - inputStart);
+
+        segment.clear();
+
+        for (int ch = 0; ch < 2 && last > first; ++ch)
+        {
+            const int sourceChannel = juce::jmin(ch, numInputChannels - 1);
+            segment.copyFrom(ch, first, input, sourceChannel, inputStart + first, last - first);
+        }
+
+        const auto state = gate.process(segment);
+
+        if (streamPos < firstSegmentPos)
+            continue;
+
+        if (SilenceGate::needsInference(state))
+        {
+            processWithDemucs(model, segment, scheduler.getStemBuffer());
+            gate.applyFade(state, scheduler.getStemBuffer());
+            scheduler.accumulateSegment();
+        }
+
+        // The finished hop starts at inputStart; clip it to the range
+        const int hopFirst = juce::jmax(0, startSample - inputStart);
+        const int hopLast = juce::jmin(hopSize, endSample - inputStart);
+
+        if (hopLast > hopFirst)
+        {
+            for (int stem = 0; stem < 4; ++stem)
+            {
+                for (int ch = 0; ch < 2; ++ch)
+                {
+                    const float* hop = scheduler.getCompletedHop(stem * 2 + ch);
+                    stemOutputs[static_cast<size_t>(stem)].copyFrom(ch, inputStart + hopFirst, hop + hopFirst, hopLast - hopFirst);
+                }
+            }
+        }
+
+        scheduler.finishHop();
+    }
+}
+
+StemSeparator::LoadedModel* StemSeparator::getOfflineModel(int quality, int sampleRate)
+{
+    // Kept between calls, so a take refined range by range loads its model once
+    if (offlineModel == nullptr || quality != offlineModelQuality || sampleRate != offlineModelSampleRate)
+    {
+        offlineModel.reset();
+        offlineModel = loadDemucsModel(quality, sampleRate);
+        offlineModelQuality = quality;
+        offlineModelSampleRate = sampleRate;
     }
+
+    return offlineModel.get();
 }
 
 void StemSeparator::processBlock(juce::AudioBuffer<float>& inputBuffer,
                                 std::array<juce::AudioBuffer<float>, 4>& stemOutputs)
 {
-    if (!initialized || !demucsModel)
+    if (!initialized)
     {
         // Pass through to all stems if not initialized
         for (auto& stem : stemOutputs)
@@ -68,69 +374,469 @@ void StemSeparator::processBlock(juce::AudioBuffer<float>& inputBuffer,
         }
         return;
     }
-    
+
     const int numSamples = inputBuffer.getNumSamples();
-    const int numChannels = inputBuffer.getNumChannels();
-    
-    // Ensure output buffers are properly sized
+
+    // Ensure output buffers are properly sized (storage was reserved in prepareToPlay)
     for (auto& stem : stemOutputs)
     {
-        stem.setSize(2, numSamples, false, false, false);
-        stem.clear();
+        stem.setSize(2, numSamples, false, false, true);
     }
-    
-    // Process in chunks if buffer is too large
-    const int chunkSize = 8192;
-    for (int start = 0; start < numSamples; start += chunkSize)
+
+    pushInput(inputBuffer);
+    popStems(stemOutputs, numSamples);
+}
+
+void StemSeparator::pushInput(const juce::AudioBuffer<float>& inputBuffer)
+{
+    const int numSamples = inputBuffer.getNumSamples();
+    const int numChannels = inputBuffer.getNumChannels();
+
+    int start1, size1, start2, size2;
+    inputFifo.prepareToWrite(numSamples, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch)
     {
-        int chunkLength = juce::jmin(chunkSize, numSamples - start);
-        
-        // Copy input chunk to processing buffer
-        processingBuffer.setSize(numChannels, chunkLength, false, false, false);
-        for (int ch = 0; ch < numChannels; ++ch)
+        const int sourceChannel = juce::jmin(ch, numChannels - 1);
+
+        if (sourceChannel < 0)
         {
-            processingBuffer.copyFrom(ch, 0, inputBuffer, ch, start, chunkLength);
+            inputRing.clear(ch, start1, size1);
+            inputRing.clear(ch, start2, size2);
+            continue;
         }
-        
-        // Process with Demucs
-        float* stems[4];
-        for (int i = 0; i < 4; ++i)
+
+        inputRing.copyFrom(ch, start1, inputBuffer, sourceChannel, 0, size1);
+        inputRing.copyFrom(ch, start2, inputBuffer, sourceChannel, size1, size2);
+    }
+
+    inputFifo.finishedWrite(size1 + size2);
+
+    // The worker has stalled long enough to fill the input ring. Dropped input
+    // will never produce stems, so it cancels samples we already zero-filled.
+    const int dropped = numSamples - (size1 + size2);
+    outputDebt = juce::jmax(0, outputDebt - dropped);
+
+    // Lock-free: the pool picks this up from its watching thread
+    if (hasPendingWork())
+        inferenceScheduler->notifyWorkAvailable();
+}
+
+void StemSeparator::discardOutputDebt()
+{
+    // Discard late stems for blocks that were already zero-filled
+    if (outputDebt > 0)
+    {
+        int start1, size1, start2, size2;
+        outputFifo.prepareToRead(outputDebt, start1, size1, start2, size2);
+        outputFifo.finishedRead(size1 + size2);
+        outputDebt -= size1 + size2;
+    }
+}
+
+int StemSeparator::takeStaleSamples(int numSamples)
+{
+    const int numStale = juce::jmin(staleSamples, numSamples);
+    staleSamples -= numStale;
+    return numStale;
+}
+
+void StemSeparator::flush()
+{
+    staleSamples = latencySamples;
+}
+
+void StemSeparator::popStems(std::array<juce::AudioBuffer<float>, 4>& stemOutputs, int numSamples)
+{
+    discardOutputDebt();
+
+    int start1, size1, start2, size2;
+    outputFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    for (int stem = 0; stem < 4; ++stem)
+    {
+        for (int ch = 0; ch < 2; ++ch)
+        {
+            const int ringChannel = stem * 2 + ch;
+            stemOutputs[stem].copyFrom(ch, 0, outputRing, ringChannel, start1, size1);
+            stemOutputs[stem].copyFrom(ch, size1, outputRing, ringChannel, start2, size2);
+        }
+    }
+
+    outputFifo.finishedRead(size1 + size2);
+
+    // Inference is running late: never wait for it, output silence instead
+    const int missing = numSamples - (size1 + size2);
+
+    if (missing > 0)
+    {
+        for (auto& stem : stemOutputs)
+        {
+            stem.clear(size1 + size2, missing);
+        }
+
+        outputDebt += missing;
+    }
+
+    const int numStale = takeStaleSamples(numSamples);
+
+    if (numStale > 0)
+    {
+        for (auto& stem : stemOutputs)
+        {
+            stem.clear(0, numStale);
+        }
+    }
+}
+
+void StemSeparator::processBlockRemix(juce::AudioBuffer<float>& buffer, const RemixTargets& targets)
+{
+    const int numSamples = buffer.getNumSamples();
+
+    if (!initialized || numSamples == 0)
+        return;
+
+    pushInput(buffer);
+    discardOutputDebt();
+
+    int start1, size1, start2, size2;
+    outputFifo.prepareToRead(numSamples, start1, size1, start2, size2);
+
+    std::array<float, 4> steps, mixGains, mixSteps;
+
+    for (size_t stem = 0; stem < 4; ++stem)
+    {
+        steps[stem] = (targets.endGains[stem] - targets.startGains[stem]) / static_cast<float>(numSamples);
+
+        const bool leavesMix = targets.removeFromMix && targets.stemOutputs[stem] != nullptr;
+        mixGains[stem] = leavesMix ? 0.0f : targets.startGains[stem];
+        mixSteps[stem] = leavesMix ? 0.0f : steps[stem];
+    }
+
+    // The ready stems are in at most two contiguous regions of the ring
+    const int regionStarts[] = { start1, start2 };
+    const int regionSizes[] = { size1, size2 };
+    int offset = 0;
+
+    for (int region = 0; region < 2; ++region)
+    {
+        const int regionSize = regionSizes[region];
+
+        if (regionSize <= 0)
+            continue;
+
+        const auto t = static_cast<float>(offset);
+
+        std::array<const float*, 4> lefts, rights;
+        std::array<float, 4> gains;
+
+        for (size_t stem = 0; stem < 4; ++stem)
+        {
+            lefts[stem] = outputRing.getReadPointer(static_cast<int>(stem) * 2, regionStarts[region]);
+            rights[stem] = outputRing.getReadPointer(static_cast<int>(stem) * 2 + 1, regionStarts[region]);
+            gains[stem] = mixGains[stem] + t * mixSteps[stem];
+        }
+
+        // A mono output gets both halves of every stem
+        if (buffer.getNumChannels() == 1)
+        {
+            mixRampedStemsMono(buffer.getWritePointer(0, offset), lefts, rights, gains, mixSteps, regionSize);
+        }
+        else
         {
-            stems[i] = stemOutputs[i].getWritePointer(0, start);
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                mixRampedStems(buffer.getWritePointer(ch, offset), ch == 0 ? lefts : rights, gains, mixSteps, regionSize);
         }
-        
-        processWithDemucs(processingBuffer.getReadPointer(0), stems, chunkLength);
-        
-        // Copy right channel if stereo
-        if (numChannels > 1)
+
+        for (size_t stem = 0; stem < 4; ++stem)
         {
-            for (int i = 0; i < 4; ++i)
+            auto* stemOutput = targets.stemOutputs[stem];
+
+            if (stemOutput == nullptr)
+                continue;
+
+            const float gain = targets.startGains[stem] + t * steps[stem];
+
+            if (stemOutput->getNumChannels() == 1)
             {
-                stemOutputs[i].copyFrom(1, start, stemOutputs[i], 0, start, chunkLength);
+                copyRampedMono(stemOutput->getWritePointer(0, offset), lefts[stem], rights[stem], gain, steps[stem], regionSize);
+                continue;
             }
+
+            for (int ch = 0; ch < stemOutput->getNumChannels(); ++ch)
+                copyRamped(stemOutput->getWritePointer(ch, offset), ch == 0 ? lefts[stem] : rights[stem], gain, steps[stem], regionSize);
+        }
+
+        offset += regionSize;
+    }
+
+    outputFifo.finishedRead(size1 + size2);
+
+    // Inference is running late: never wait for it, output silence instead
+    const int missing = numSamples - offset;
+
+    if (missing > 0)
+    {
+        buffer.clear(offset, missing);
+
+        for (auto* stemOutput : targets.stemOutputs)
+        {
+            if (stemOutput != nullptr)
+                stemOutput->clear(offset, missing);
+        }
+
+        outputDebt += missing;
+    }
+
+    const int numStale = takeStaleSamples(numSamples);
+
+    if (numStale > 0)
+    {
+        buffer.clear(0, numStale);
+
+        for (auto* stemOutput : targets.stemOutputs)
+        {
+            if (stemOutput != nullptr)
+                stemOutput->clear(0, numStale);
         }
     }
 }
 
-void StemSeparator::processWithDemucs(const float* input, float** outputs, int numSamples)
+bool StemSeparator::hasPendingWork() const
 {
-    if (!demucsModel)
-        return;
-        
-    // Convert to Demucs format and process
-    // This is a simplified interface - actual implementation would need
-    // proper format conversion and tensor handling
-    demucs_separate(demucsModel, input, outputs, numSamples);
+    return inputFifo.getNumReady() >= segmentScheduler.getSegmentLength()
+        && outputFifo.getFreeSpace() >= segmentScheduler.getHopSize();
 }
 
-void StemSeparator::setModelQuality(int quality)
+double StemSeparator::getDeadlineMs() const
 {
-    if (modelQuality != quality)
+    // The audio thread underruns once the stems already queued have been played
+    const double bufferedMs = 1000.0 * outputFifo.getNumReady() / currentSampleRate;
+    return juce::Time::getMillisecondCounterHiRes() + bufferedMs;
+}
+
+void StemSeparator::processNextUnit()
+{
+    if (hasPendingWork())
+        separateNextSegment();
+}
+
+void StemSeparator::separateNextSegment()
+{
+    adoptPublishedModel();
+
+    const int segmentSize = segmentScheduler.getSegmentLength();
+    const int hopSize = segmentScheduler.getHopSize();
+
+    // Read a whole segment but only consume one hop; the rest is the overlap
+    // with the next segment
+    auto& segment = segmentScheduler.getSegmentBuffer();
+    int start1, size1, start2, size2;
+    inputFifo.prepareToRead(segmentSize, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < 2; ++ch)
     {
-        modelQuality = quality;
-        if (initialized)
+        segment.copyFrom(ch, 0, inputRing, ch, start1, size1);
+        segment.copyFrom(ch, size1, inputRing, ch, start2, size2);
+    }
+
+    inputFifo.finishedRead(hopSize);
+
+    // Segment k starts k hops into the (primed) input stream, and completes the hop it starts with
+    const juce::int64 segmentNumber = segmentIndex++;
+    const juce::int64 hopStart = segmentNumber * hopSize;
+    inferenceMemo.addInput(segment, hopStart);
+
+    // The gate sees every segment, replayed or not, so it ends up in the same
+    // state as if the model had run throughout
+    const auto gate = silenceGate.process(segment);
+    gateHistory[static_cast<size_t>(segmentNumber % static_cast<juce::int64>(gateHistory.size()))] = gate;
+
+    // A model crossfade always runs the models
+    const bool crossfading = fadingOutModel != nullptr;
+    const juce::int64 loopLength = loopLengthHint.load();
+    inferenceMemo.reserveForPeriod(loopLength);
+    const juce::int64 repeat = crossfading ? -1 : inferenceMemo.findRepeat(hopStart, loopLength);
+    const float* hop[numStemChannels];
+
+    if (repeat >= 0)
+    {
+        // The host is playing input we have separated before: replay those stems
+        inferenceMemo.readStems(repeat, memoHop);
+
+        for (int ch = 0; ch < numStemChannels; ++ch)
+            hop[ch] = memoHop.getReadPointer(ch);
+
+        schedulerSkipped = true;
+    }
+    else
+    {
+        const bool separate = SilenceGate::needsInference(gate);
+
+        if (schedulerSkipped)
+            reprimeScheduler(hopStart);
+
+        if (separate)
+        {
+            // Process with Demucs
+            runInference(segment, segmentScheduler.getStemBuffer());
+            silenceGate.applyFade(gate, segmentScheduler.getStemBuffer());
+            segmentScheduler.accumulateSegment();
+        }
+        else if (crossfading)
+        {
+            // Nothing to crossfade in silence: the new model takes over directly
+            retiringModel = fadingOutModel;
+            fadingOutModel = nullptr;
+        }
+
+        for (int ch = 0; ch < numStemChannels; ++ch)
+            hop[ch] = segmentScheduler.getCompletedHop(ch);
+    }
+
+    outputFifo.prepareToWrite(hopSize, start1, size1, start2, size2);
+
+    for (int ch = 0; ch < numStemChannels; ++ch)
+    {
+        outputRing.copyFrom(ch, start1, hop[ch], size1);
+        outputRing.copyFrom(ch, start2, hop[ch] + size1, size2);
+    }
+
+    outputFifo.finishedWrite(size1 + size2);
+    inferenceMemo.addStems(hopStart, hop, hopSize);
+
+    if (crossfading)
+        inferenceMemo.invalidate();
+
+    if (repeat < 0)
+        segmentScheduler.finishHop();
+}
+
+void StemSeparator::reprimeScheduler(juce::int64 hopStart)
+{
+    // Replayed hops skipped the model, so overlap-add is missing the segments
+    // that overlap this one. Run them again from the memo's input history,
+    // gated and faded as they would have been; the hops they complete were
+    // already sent from the memo.
+    const int hopSize = segmentScheduler.getHopSize();
+    const int hopsPerSegment = segmentScheduler.getSegmentLength() / hopSize;
+    auto& segment = segmentScheduler.getSegmentBuffer();
+
+    segmentScheduler.reset();
+
+    for (int back = hopsPerSegment - 1; back > 0; --back)
+    {
+        const juce::int64 start = hopStart - back * hopSize;
+
+        if (start >= 0)
         {
-            loadDemucsModel();
+            const auto gate = gateHistory[static_cast<size_t>((segmentIndex - 1 - back) % static_cast<juce::int64>(gateHistory.size()))];
+
+            if (SilenceGate::needsInference(gate))
+            {
+                inferenceMemo.readInput(start, segment);
+                processWithDemucs(demucsModel, segment, segmentScheduler.getStemBuffer());
+                silenceGate.applyFade(gate, segmentScheduler.getStemBuffer());
+                segmentScheduler.accumulateSegment();
+            }
         }
+
+        segmentScheduler.finishHop();
     }
-}
\ No newline at end of file
+
+    // reset() cleared this segment's input too
+    inferenceMemo.readInput(hopStart, segment);
+    schedulerSkipped = false;
+}
+
+void StemSeparator::adoptPublishedModel()
+{
+    // A model whose crossfade has finished goes back to the loader thread
+    if (retiringModel != nullptr && modelPublisher.retire(retiringModel))
+        retiringModel = nullptr;
+
+    // One swap at a time; a newer model simply waits in the publisher
+    if (fadingOutModel != nullptr || retiringModel != nullptr)
+        return;
+
+    if (auto* next = modelPublisher.exchangePending())
+    {
+        fadingOutModel = demucsModel;
+        demucsModel = next;
+
+        // Stems from the old model must not be replayed
+        inferenceMemo.invalidate();
+    }
+}
+
+void StemSeparator::runInference(const juce::AudioBuffer<float>& segment, juce::AudioBuffer<float>& stems)
+{
+    processWithDemucs(demucsModel, segment, stems);
+
+    if (fadingOutModel == nullptr)
+        return;
+
+    // Run the outgoing model once more and fade across the segment; overlap-add
+    // spreads the transition further into the neighbouring hops
+    processWithDemucs(fadingOutModel, segment, fadeOutStems);
+
+    const int numSamples = stems.getNumSamples();
+
+    for (int ch = 0; ch < numStemChannels; ++ch)
+    {
+        float* dest = stems.getWritePointer(ch);
+        juce::FloatVectorOperations::multiply(dest, fadeInRamp.get(), numSamples);
+        juce::FloatVectorOperations::addWithMultiply(dest, fadeOutStems.getReadPointer(ch), fadeOutRamp.get(), numSamples);
+    }
+
+    retiringModel = fadingOutModel;
+    fadingOutModel = nullptr;
+}
+
+void StemSeparator::processWithDemucs(LoadedModel* model, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& stems)
+{
+    if (!model || !model->model)
+    {
+        stems.clear();
+        return;
+    }
+
+    // Both buffers are planar and stem-major (drums L, drums R, bass L, ...),
+    // which is exactly the layout of the planar C API
+    demucs_separate_planar(model->model,
+                           input.getArrayOfReadPointers(), input.getNumChannels(), 1,
+                           stems.getArrayOfWritePointers(), stems.getNumChannels() / 4, 1,
+                           input.getNumSamples());
+}
+
+juce::String StemSeparator::getModelIdentity(int quality) const
+{
+    // Same lookup as ModelRegistry::acquire()
+    const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(getModelPath(quality < 0 ? requestedModelQuality.load() : quality));
+
+    juce::String identity = file.existsAsFile()
+        ? file.getFileName() + ":" + juce::String(file.getSize()) + ":" + juce::String(file.getLastModificationTime().toMilliseconds())
+        : juce::String("builtin");
+
+    // The silence gate changes the offline output; the inference memo only
+    // replays what the model would produce, and is not used offline
+    return identity + ";segment=" + juce::String(segmentLength) + ";overlap=" + juce::String(segmentOverlap)
+         + ";gate=" + juce::String(STEMSPLITTER_GATE_THRESHOLD_DB);
+}
+
+void StemSeparator::setPlayheadPosition(juce::int64 timeInSamples, bool isPlaying, int numSamples)
+{
+    const bool known = isPlaying && timeInSamples >= 0;
+
+    if (known && lastPlayheadEnd >= 0 && timeInSamples < lastPlayheadEnd)
+        loopLengthHint.store(lastPlayheadEnd - timeInSamples);
+
+    lastPlayheadEnd = known ? timeInSamples + numSamples : -1;
+}
+
+void StemSeparator::setModelQuality(int quality)
+{
+    // Called from the audio thread every block: only records the request,
+    // the loader thread does the work
+    requestedModelQuality.store(quality);
+}
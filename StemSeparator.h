@@ -1,8 +1,24 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "SegmentScheduler.h"
+#include "AtomicPublisher.h"
+#include "ModelRegistry.h"
+#include "InferenceScheduler.h"
+#include "InferenceMemo.h"
+#include "SilenceGate.h"
 
-class StemSeparator
+#ifndef STEMSPLITTER_SEGMENT_LENGTH
+ #define STEMSPLITTER_SEGMENT_LENGTH 8192
+#endif
+
+#ifndef STEMSPLITTER_SEGMENT_OVERLAP
+ #define STEMSPLITTER_SEGMENT_OVERLAP 0.5f
+#endif
+
+struct DemucsModel;
+
+class StemSeparator : private InferenceScheduler::Client
 {
 public:
     enum class StemType
@@ -15,28 +31,168 @@ public:
     };
 
     StemSeparator();
-    ~StemSeparator();
+    ~StemSeparator() override;
+
+    // Segment length trades CPU (longer = fewer model calls) against latency.
+    // Takes effect on the next initialize().
+    void setSegmentSettings(int segmentLengthSamples, float segmentOverlap);
 
     void initialize(int sampleRate, int bufferSize);
     void processBlock(juce::AudioBuffer<float>& inputBuffer,
                      std::array<juce::AudioBuffer<float>, 4>& stemOutputs);
-    
+
+    // Where processBlockRemix() sends one block of stems. Gains ramp linearly
+    // from startGains to endGains across the block.
+    struct RemixTargets
+    {
+        std::array<float, 4> startGains {};
+        std::array<float, 4> endGains {};
+        std::array<juce::AudioBuffer<float>*, 4> stemOutputs {}; // optional, e.g. host aux buses
+        bool removeFromMix = false; // stems with an output leave the main mix
+    };
+
+    // Live remix fast path: separates buffer in place of processBlock(), then
+    // overwrites it with the gained sum of the stems in one pass straight from
+    // the output ring, without per-stem copies
+    void processBlockRemix(juce::AudioBuffer<float>& buffer, const RemixTargets& targets);
+
+    // Fastest model quality, used for previews that are refined later
+    static constexpr int previewQuality = 0;
+
+    // Separates a whole buffer on the calling thread, bypassing the realtime
+    // rings and the shared pool. Stems are time-aligned with the input.
+    // Safe to call on an uninitialised separator, e.g. from a batch tool.
+    // quality < 0 uses the setModelQuality() setting.
+    void separateOffline(const juce::AudioBuffer<float>& input, int sampleRate,
+                         std::array<juce::AudioBuffer<float>, 4>& stemOutputs, int quality = -1);
+
+    // Separates only input samples [startSample, startSample + numSamples) into
+    // stemOutputs, which must already hold the whole input length. The result
+    // is identical to that range of separateOffline(), so ranges separated one
+    // at a time join seamlessly.
+    void separateOfflineRange(const juce::AudioBuffer<float>& input, int sampleRate,
+                              std::array<juce::AudioBuffer<float>, 4>& stemOutputs,
+                              int startSample, int numSamples, int quality = -1);
+
+    // Identifies what separateOffline() produces with the given quality (or
+    // the current setting): the model file (with its size and date) or the
+    // built-in fallback, the segmentation and the silence gate threshold.
+    // Used to key cached stems.
+    juce::String getModelIdentity(int quality = -1) const;
+
     bool isInitialized() const { return initialized; }
-    
+
+    // Fixed delay between input and the stems returned by processBlock
+    int getLatencySamples() const { return latencySamples; }
+
     void setModelQuality(int quality); // 0-3 for different Demucs models
-    
+    int getModelQuality() const { return requestedModelQuality.load(); }
+
+    // Host timeline at the start of the next block (audio thread, before
+    // processBlock; timeInSamples < 0 if unknown). A jump back while playing
+    // is taken as a loop wrap, and its length is tried as the repeat period
+    // for the inference memo.
+    void setPlayheadPosition(juce::int64 timeInSamples, bool isPlaying, int numSamples);
+
+    // Call on the audio thread when input resumes after the host stopped
+    // feeding it: the stems still in flight belong to the old input, so the
+    // next getLatencySamples() output samples are silenced.
+    void flush();
+
 private:
-    void loadDemucsModel();
-    void processWithDemucs(const float* input, float** outputs, int numSamples);
-    
+    class ModelLoader;
+
+    // A per-instance Demucs model and the shared weights it reads from
+    struct LoadedModel
+    {
+        ~LoadedModel();
+
+        DemucsModel* model = nullptr;
+        ModelRegistry::WeightsPtr weights;
+    };
+
+    using ModelPtr = std::unique_ptr<LoadedModel>;
+
+    ModelPtr loadDemucsModel(int quality, int sampleRate);
+    void processWithDemucs(LoadedModel* model, const juce::AudioBuffer<float>& input, juce::AudioBuffer<float>& stems);
+    LoadedModel* getOfflineModel(int quality, int sampleRate);
+
+    // Loader thread: publishes a new model when the requested quality changes
+    void loadRequestedModel();
+
+    // Inference side: picks up a published model and crossfades into it
+    void adoptPublishedModel();
+    void runInference(const juce::AudioBuffer<float>& segment, juce::AudioBuffer<float>& stems);
+
+    // Audio thread side of the ring buffers
+    void pushInput(const juce::AudioBuffer<float>& inputBuffer);
+    void popStems(std::array<juce::AudioBuffer<float>, 4>& stemOutputs, int numSamples);
+    void discardOutputDebt();
+    int takeStaleSamples(int numSamples);
+
+    // InferenceScheduler::Client: the shared pool separates one segment at a time
+    bool hasPendingWork() const override;
+    double getDeadlineMs() const override;
+    void processNextUnit() override;
+
+    void separateNextSegment();
+    void reprimeScheduler(juce::int64 hopStart);
+
+    static constexpr int numStemChannels = SegmentScheduler::numStemChannels;
+
     bool initialized = false;
     int currentSampleRate = 44100;
     int currentBufferSize = 512;
-    int modelQuality = 2;
-    
-    // Demucs model interface
-    void* demucsModel = nullptr;
-    juce::AudioBuffer<float> processingBuffer;
-    
+    int loadedModelQuality = -1;
+    std::atomic<int> requestedModelQuality { 2 };
+    int latencySamples = 0;
+    int segmentLength = STEMSPLITTER_SEGMENT_LENGTH;
+    float segmentOverlap = STEMSPLITTER_SEGMENT_OVERLAP;
+
+    // Models are loaded on the loader thread and handed to the inference jobs,
+    // which own demucsModel and hand replaced models back for deletion
+    juce::SharedResourcePointer<ModelRegistry> modelRegistry;
+    AtomicPublisher<LoadedModel> modelPublisher;
+    LoadedModel* demucsModel = nullptr;
+    LoadedModel* fadingOutModel = nullptr;
+    LoadedModel* retiringModel = nullptr;
+
+    // Offline separation only, on the calling thread
+    ModelPtr offlineModel;
+    int offlineModelQuality = -1;
+    int offlineModelSampleRate = 0;
+
+    SegmentScheduler segmentScheduler;
+    SilenceGate silenceGate;
+    std::vector<SilenceGate::State> gateHistory; // last segment's worth of gate states, by segment index
+    juce::AudioBuffer<float> fadeOutStems;
+    juce::HeapBlock<float> fadeInRamp;
+    juce::HeapBlock<float> fadeOutRamp;
+
+    // Replays stems for input the host plays again; worker side only, apart
+    // from the loop length hint written by the audio thread
+    InferenceMemo inferenceMemo;
+    juce::AudioBuffer<float> memoHop;
+    juce::int64 segmentIndex = 0;
+    bool schedulerSkipped = false; // overlap-add is missing the replayed segments
+    std::atomic<juce::int64> loopLengthHint { 0 };
+    juce::int64 lastPlayheadEnd = -1;
+
+    // Lock-free SPSC rings: audio thread -> worker (input), worker -> audio thread (stems)
+    juce::AbstractFifo inputFifo { 1 };
+    juce::AudioBuffer<float> inputRing;
+    juce::AbstractFifo outputFifo { 1 };
+    juce::AudioBuffer<float> outputRing;
+
+    // Stem samples owed to the output stream after an underrun (audio thread only)
+    int outputDebt = 0;
+
+    // Output samples still to silence after a flush (audio thread only)
+    int staleSamples = 0;
+
+    juce::SharedResourcePointer<InferenceScheduler> inferenceScheduler;
+    bool registeredWithScheduler = false;
+    std::unique_ptr<ModelLoader> modelLoader;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemSeparator)
-};
\ No newline at end of file
+};
@@ -0,0 +1,336 @@
+#include "StemStorage.h"
+
+namespace
+{
+    inline std::uint32_t floatBits(float value) noexcept
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float bitsToFloat(std::uint32_t bits) noexcept
+    {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Round to nearest; overflows saturate at the largest finite half and NaN
+    // becomes the canonical half NaN. Half subnormals are handled in integer
+    // arithmetic, so this and the decoder behave the same with denormals flushed.
+    std::uint16_t floatToHalf(float value) noexcept
+    {
+        if (std::isnan(value))
+            return 0x7e00u;
+
+        const std::uint32_t sign = (floatBits(value) >> 16) & 0x8000u;
+        const float magnitude = juce::jmin(std::abs(value), 65504.0f);
+
+        if (magnitude < 6.103515625e-05f) // below the smallest normal half
+            return static_cast<std::uint16_t>(sign | static_cast<std::uint32_t>(magnitude * 16777216.0f + 0.5f));
+
+        const std::uint32_t rebiased = floatBits(magnitude) - (112u << 23);
+        return static_cast<std::uint16_t>(sign | juce::jmin(0x7bffu, (rebiased + 0x1000u) >> 13));
+    }
+
+    inline float halfToFloat(std::uint16_t half) noexcept
+    {
+        const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+        const std::uint32_t magnitude = half & 0x7fffu;
+
+        const float normal = bitsToFloat((magnitude << 13) + (112u << 23));
+        const float subnormal = static_cast<float>(magnitude) * 5.9604644775390625e-08f; // 2^-24
+
+        return bitsToFloat(floatBits(magnitude < 0x400u ? subnormal : normal) | sign);
+    }
+
+    // One LSB of TPDF dither, a function of the sample's place in the stem
+    // only, so any span encodes the same wherever the encoding starts
+    inline float ditherAt(int channel, int index) noexcept
+    {
+        auto h = static_cast<std::uint32_t>(index) * 0x9e3779b1u ^ static_cast<std::uint32_t>(channel + 1) * 0x85ebca77u;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        h *= 0x846ca68bu;
+        h ^= h >> 16;
+
+        return static_cast<float>(h & 0xffffu) / 65536.0f - static_cast<float>(h >> 16) / 65536.0f;
+    }
+}
+
+//==============================================================================
+void StemStorage::setFrom(const juce::AudioBuffer<float>& source, Format formatToUse,
+                          std::shared_ptr<const void> sharedSource)
+{
+    format = formatToUse;
+    numChannels = source.getNumChannels();
+    numSamples = source.getNumSamples();
+
+    floatData.setSize(0, 0);
+    sharedData = nullptr;
+    compactData.clear();
+    compactData.shrink_to_fit();
+    int16Scales.clear();
+
+    if (format == Format::float32)
+    {
+        if (sharedSource != nullptr)
+        {
+            // Only read pointers are ever handed out
+            floatData.setDataToReferTo(const_cast<float**>(source.getArrayOfReadPointers()), numChannels, numSamples);
+            sharedData = std::move(sharedSource);
+        }
+        else
+        {
+            floatData.makeCopyOf(source);
+        }
+
+        return;
+    }
+
+    compactData.resize(static_cast<size_t>(numChannels) * static_cast<size_t>(numSamples));
+
+    if (format == Format::float16)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            const auto* in = source.getReadPointer(ch);
+            auto* out = compactData.data() + static_cast<size_t>(ch) * static_cast<size_t>(numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                out[i] = floatToHalf(in[i]);
+        }
+
+        return;
+    }
+
+    // int16: full scale is the peak of each block
+    int16Scales.assign(static_cast<size_t>((numSamples + int16BlockLength - 1) / int16BlockLength), 1.0f);
+
+    for (int blockStart = 0; blockStart < numSamples; blockStart += int16BlockLength)
+        encodeInt16Block(source, blockStart, blockStart);
+}
+
+void StemStorage::encodeInt16Block(const juce::AudioBuffer<float>& source, int sourceStartSample, int blockStart)
+{
+    const int blockLength = juce::jmin(int16BlockLength, numSamples - blockStart);
+    const float peak = source.getMagnitude(sourceStartSample, blockLength);
+    const float scale = peak > 0.0f ? peak / 32767.0f : 1.0f;
+
+    int16Scales[static_cast<size_t>(blockStart / int16BlockLength)] = scale;
+    quantiseInt16(source, sourceStartSample, blockStart, blockLength, scale);
+}
+
+void StemStorage::quantiseInt16(const juce::AudioBuffer<float>& source, int sourceStartSample,
+                                int destStartSample, int numToWrite, float scale)
+{
+    const float toInteger = 1.0f / scale;
+
+    for (int ch = 0; ch < juce::jmin(numChannels, source.getNumChannels()); ++ch)
+    {
+        const auto* in = source.getReadPointer(ch, sourceStartSample);
+        auto* out = compactData.data() + static_cast<size_t>(ch) * static_cast<size_t>(numSamples)
+                                       + static_cast<size_t>(destStartSample);
+
+        for (int i = 0; i < numToWrite; ++i)
+        {
+            const float scaled = std::round(in[i] * toInteger + ditherAt(ch, destStartSample + i));
+            const auto quantised = static_cast<std::int16_t>(juce::jlimit(-32767.0f, 32767.0f, scaled));
+            out[i] = static_cast<std::uint16_t>(quantised);
+        }
+    }
+}
+
+void StemStorage::makeCopyOf(const StemStorage& other)
+{
+    format = other.format;
+    numChannels = other.numChannels;
+    numSamples = other.numSamples;
+    int16Scales = other.int16Scales;
+    sharedData = other.sharedData;
+    compactData = other.compactData;
+
+    if (sharedData != nullptr)
+        floatData.setDataToReferTo(const_cast<float**>(other.floatData.getArrayOfReadPointers()), numChannels, numSamples);
+    else
+        floatData.makeCopyOf(other.floatData);
+}
+
+void StemStorage::write(const juce::AudioBuffer<float>& source, int sourceStartSample, int destStartSample, int numToWrite)
+{
+    jassert(destStartSample >= 0 && destStartSample + numToWrite <= numSamples);
+    jassert(sourceStartSample >= 0 && sourceStartSample + numToWrite <= source.getNumSamples());
+
+    if (numToWrite <= 0)
+        return;
+
+    const int channelsToWrite = juce::jmin(numChannels, source.getNumChannels());
+
+    if (format == Format::float32)
+    {
+        // Never write into memory owned elsewhere
+        if (sharedData != nullptr)
+        {
+            juce::AudioBuffer<float> copy;
+            copy.makeCopyOf(floatData);
+            floatData = std::move(copy);
+            sharedData = nullptr;
+        }
+
+        for (int ch = 0; ch < channelsToWrite; ++ch)
+            floatData.copyFrom(ch, destStartSample, source, ch, sourceStartSample, numToWrite);
+
+        return;
+    }
+
+    if (format == Format::float16)
+    {
+        for (int ch = 0; ch < channelsToWrite; ++ch)
+        {
+            const auto* in = source.getReadPointer(ch, sourceStartSample);
+            auto* out = compactData.data() + static_cast<size_t>(ch) * static_cast<size_t>(numSamples)
+                                           + static_cast<size_t>(destStartSample);
+
+            for (int i = 0; i < numToWrite; ++i)
+                out[i] = floatToHalf(in[i]);
+        }
+
+        return;
+    }
+
+    // int16: blocks the write covers are encoded afresh. A partly covered
+    // block keeps its scale unless the new samples exceed it; then only that
+    // block is decoded and re-encoded.
+    const int endSample = destStartSample + numToWrite;
+    const int sourceOffset = sourceStartSample - destStartSample;
+
+    for (int blockStart = destStartSample - destStartSample % int16BlockLength; blockStart < endSample; blockStart += int16BlockLength)
+    {
+        const int blockEnd = juce::jmin(blockStart + int16BlockLength, numSamples);
+        const int first = juce::jmax(blockStart, destStartSample);
+        const int last = juce::jmin(blockEnd, endSample);
+
+        if (first == blockStart && last == blockEnd)
+        {
+            encodeInt16Block(source, blockStart + sourceOffset, blockStart);
+            continue;
+        }
+
+        const float scale = int16Scales[static_cast<size_t>(blockStart / int16BlockLength)];
+
+        if (source.getMagnitude(first + sourceOffset, last - first) <= scale * 32767.0f)
+        {
+            quantiseInt16(source, first + sourceOffset, first, last - first, scale);
+            continue;
+        }
+
+        juce::AudioBuffer<float> block(numChannels, blockEnd - blockStart);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            decodeRange(ch, blockStart, blockEnd - blockStart, block.getWritePointer(ch));
+
+        for (int ch = 0; ch < channelsToWrite; ++ch)
+            block.copyFrom(ch, first - blockStart, source, ch, first + sourceOffset, last - first);
+
+        encodeInt16Block(block, 0, blockStart);
+    }
+}
+
+void StemStorage::alignToBlocks(int length, int& startSample, int& endSample) noexcept
+{
+    startSample -= startSample % int16BlockLength;
+    endSample = juce::jmin(length, (endSample + int16BlockLength - 1) / int16BlockLength * int16BlockLength);
+}
+
+size_t StemStorage::getSizeInBytes() const noexcept
+{
+    if (format == Format::float32)
+        return static_cast<size_t>(numChannels) * static_cast<size_t>(numSamples) * sizeof(float);
+
+    return compactData.size() * sizeof(std::uint16_t);
+}
+
+const float* StemStorage::getFloatPointer(int channel) const noexcept
+{
+    return format == Format::float32 ? floatData.getReadPointer(channel) : nullptr;
+}
+
+void StemStorage::decode(int channel, int startIndex, int numToDecode, float* dest) const noexcept
+{
+    if (numSamples == 0 || numToDecode <= 0)
+    {
+        std::fill(dest, dest + juce::jmax(0, numToDecode), 0.0f);
+        return;
+    }
+
+    // Hold the edge samples outside the stem
+    const int endIndex = startIndex + numToDecode;
+    const int first = juce::jlimit(startIndex, endIndex, 0);
+    const int last = juce::jlimit(first, endIndex, numSamples);
+
+    if (first > startIndex)
+    {
+        float edge;
+        decodeRange(channel, 0, 1, &edge);
+        std::fill(dest, dest + (first - startIndex), edge);
+    }
+
+    decodeRange(channel, first, last - first, dest + (first - startIndex));
+
+    if (last < endIndex)
+    {
+        float edge;
+        decodeRange(channel, numSamples - 1, 1, &edge);
+        std::fill(dest + (last - startIndex), dest + numToDecode, edge);
+    }
+}
+
+void StemStorage::decodeRange(int channel, int startIndex, int numToDecode, float* dest) const noexcept
+{
+    if (numToDecode <= 0)
+        return;
+
+    if (format == Format::float32)
+    {
+        std::copy_n(floatData.getReadPointer(channel, startIndex), numToDecode, dest);
+        return;
+    }
+
+    const auto* in = compactData.data() + static_cast<size_t>(channel) * static_cast<size_t>(numSamples)
+                                        + static_cast<size_t>(startIndex);
+
+    if (format == Format::float16)
+    {
+        for (int i = 0; i < numToDecode; ++i)
+            dest[i] = halfToFloat(in[i]);
+
+        return;
+    }
+
+    // int16, a block's scale at a time
+    for (int i = 0; i < numToDecode;)
+    {
+        const int block = (startIndex + i) / int16BlockLength;
+        const int run = juce::jmin(numToDecode - i, (block + 1) * int16BlockLength - (startIndex + i));
+        const float scale = int16Scales[static_cast<size_t>(block)];
+
+        for (int j = i; j < i + run; ++j)
+            dest[j] = static_cast<float>(static_cast<std::int16_t>(in[j])) * scale;
+
+        i += run;
+    }
+}
+
+const char* StemStorage::getFormatName(Format format) noexcept
+{
+    switch (format)
+    {
+        case Format::float32: return "float32";
+        case Format::float16: return "float16";
+        case Format::int16:   return "int16";
+    }
+
+    return "";
+}
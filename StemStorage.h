@@ -0,0 +1,74 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Planar sample storage for loaded stems. float16 and int16 halve the memory
+// (and the bandwidth each voice pulls through the cache) against float32;
+// int16 is TPDF-dithered and scaled to the peak of each int16BlockLength
+// block, float16 keeps 11 bits of precision at any level. decode() turns a span back into floats with
+// loops the compiler vectorises.
+class StemStorage
+{
+public:
+    enum class Format
+    {
+        float32,
+        float16,
+        int16
+    };
+
+    static constexpr int int16BlockLength = 4096;
+
+    StemStorage() = default;
+
+    // Encodes source; slow, call off the audio thread. With sharedSource set,
+    // float32 storage refers to source's samples (e.g. a mapped cache file)
+    // and keeps sharedSource alive instead of copying them.
+    void setFrom(const juce::AudioBuffer<float>& source, Format formatToUse,
+                 std::shared_ptr<const void> sharedSource = nullptr);
+
+    // Copies other; shared float32 samples stay shared until written to
+    void makeCopyOf(const StemStorage& other);
+
+    // Re-encodes numToWrite samples at destStartSample from source, starting at
+    // sourceStartSample; slow, call off the audio thread. int16 blocks the
+    // range covers completely come out as setFrom() would encode them.
+    void write(const juce::AudioBuffer<float>& source, int sourceStartSample, int destStartSample, int numToWrite);
+
+    // Widens [startSample, endSample) of a stem length samples long to whole
+    // int16 blocks, so a write() over it matches setFrom() in every format
+    static void alignToBlocks(int length, int& startSample, int& endSample) noexcept;
+
+    Format getFormat() const noexcept { return format; }
+    int getNumChannels() const noexcept { return numChannels; }
+    int getNumSamples() const noexcept { return numSamples; }
+    size_t getSizeInBytes() const noexcept;
+
+    // Direct access for float32 storage, nullptr otherwise
+    const float* getFloatPointer(int channel) const noexcept;
+
+    // dest[i] = sample (startIndex + i), with indices outside the stem
+    // clamped to the first/last sample
+    void decode(int channel, int startIndex, int numToDecode, float* dest) const noexcept;
+
+    static const char* getFormatName(Format format) noexcept;
+
+private:
+    void decodeRange(int channel, int startIndex, int numToDecode, float* dest) const noexcept;
+
+    // int16 only: picks the scale of the block starting at blockStart from source
+    void encodeInt16Block(const juce::AudioBuffer<float>& source, int sourceStartSample, int blockStart);
+    void quantiseInt16(const juce::AudioBuffer<float>& source, int sourceStartSample,
+                       int destStartSample, int numToWrite, float scale);
+
+    Format format = Format::float32;
+    int numChannels = 0;
+    int numSamples = 0;
+    std::vector<float> int16Scales; // int16 full scale of each block, in sample units
+
+    juce::AudioBuffer<float> floatData;
+    std::shared_ptr<const void> sharedData;
+    std::vector<std::uint16_t> compactData; // channel-major
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(StemStorage)
+};
@@ -0,0 +1,324 @@
+#include "VoiceInterpolator.h"
+
+namespace
+{
+    using Vec = juce::dsp::SIMDRegister<float>;
+    constexpr int lanes = static_cast<int>(Vec::SIMDNumElements);
+
+    //==============================================================================
+    // Each kernel gathers its taps for one group of output samples into
+    // aligned lanes, then evaluates the whole group with SIMD arithmetic.
+    struct LinearKernel
+    {
+        static constexpr int preRoll = 0;
+        static constexpr int postRoll = 1;
+
+        template <typename Reader>
+        void gather(Reader&& read, int index, float frac, int lane) noexcept
+        {
+            x0[lane] = read(index);
+            x1[lane] = read(index + 1);
+            f[lane] = frac;
+        }
+
+        Vec compute() const noexcept
+        {
+            const auto a = Vec::fromRawArray(x0);
+            const auto b = Vec::fromRawArray(x1);
+            return a + Vec::fromRawArray(f) * (b - a);
+        }
+
+        alignas(Vec::SIMDNumBytes) float x0[lanes] {};
+        alignas(Vec::SIMDNumBytes) float x1[lanes] {};
+        alignas(Vec::SIMDNumBytes) float f[lanes] {};
+    };
+
+    struct HermiteKernel
+    {
+        static constexpr int preRoll = 1;
+        static constexpr int postRoll = 2;
+
+        template <typename Reader>
+        void gather(Reader&& read, int index, float frac, int lane) noexcept
+        {
+            xm1[lane] = read(index - 1);
+            x0[lane] = read(index);
+            x1[lane] = read(index + 1);
+            x2[lane] = read(index + 2);
+            f[lane] = frac;
+        }
+
+        Vec compute() const noexcept
+        {
+            const auto a = Vec::fromRawArray(xm1);
+            const auto b = Vec::fromRawArray(x0);
+            const auto c = Vec::fromRawArray(x1);
+            const auto d = Vec::fromRawArray(x2);
+            const auto t = Vec::fromRawArray(f);
+
+            const auto c1 = (c - a) * 0.5f;
+            const auto c2 = a - b * 2.5f + c * 2.0f - d * 0.5f;
+            const auto c3 = (d - a) * 0.5f + (b - c) * 1.5f;
+
+            return ((c3 * t + c2) * t + c1) * t + b;
+        }
+
+        alignas(Vec::SIMDNumBytes) float xm1[lanes] {};
+        alignas(Vec::SIMDNumBytes) float x0[lanes] {};
+        alignas(Vec::SIMDNumBytes) float x1[lanes] {};
+        alignas(Vec::SIMDNumBytes) float x2[lanes] {};
+        alignas(Vec::SIMDNumBytes) float f[lanes] {};
+    };
+
+    //==============================================================================
+    constexpr int sincTaps = 8;
+    constexpr int sincPhases = 512;
+
+    // Tables for increments up to each of these; above 1 source sample per
+    // output sample the cutoff drops with the output's Nyquist
+    constexpr double sincBandIncrements[] = { 1.0, 1.25, 1.5625, 2.0 };
+    constexpr int numSincBands = static_cast<int>(std::size(sincBandIncrements));
+
+    // One row of taps per fractional phase, plus a final row for frac == 1
+    struct SincTable
+    {
+        explicit SincTable(double maxIncrement)
+        {
+            // Just below the output's Nyquist, so pitched-down playback stays
+            // bright and pitched-up playback does not fold back
+            const double cutoff = 0.9 / maxIncrement;
+            constexpr double halfWidth = sincTaps / 2;
+
+            for (int phase = 0; phase <= sincPhases; ++phase)
+            {
+                const double frac = static_cast<double>(phase) / sincPhases;
+                double sum = 0.0;
+
+                for (int k = 0; k < sincTaps; ++k)
+                {
+                    // Tap k reads source[index - 3 + k]
+                    const double x = (k - (halfWidth - 1)) - frac;
+                    const double px = juce::MathConstants<double>::pi * cutoff * x;
+                    const double sinc = std::abs(x) < 1.0e-9 ? 1.0 : std::sin(px) / px;
+
+                    const double w = (x + halfWidth) / (2.0 * halfWidth);
+                    const double window = 0.42 - 0.5 * std::cos(juce::MathConstants<double>::twoPi * w)
+                                               + 0.08 * std::cos(2.0 * juce::MathConstants<double>::twoPi * w);
+
+                    coefficients[phase][k] = static_cast<float>(sinc * window);
+                    sum += sinc * window;
+                }
+
+                // Unity gain at DC for every phase
+                for (int k = 0; k < sincTaps; ++k)
+                    coefficients[phase][k] = static_cast<float>(coefficients[phase][k] / sum);
+            }
+        }
+
+        float coefficients[sincPhases + 1][sincTaps];
+    };
+
+    struct SincTables
+    {
+        SincTables()
+        {
+            for (double maxIncrement : sincBandIncrements)
+                tables.push_back(std::make_unique<SincTable>(maxIncrement));
+        }
+
+        std::vector<std::unique_ptr<SincTable>> tables;
+    };
+
+    // Increments beyond the last band use its table; the sampler's mip levels
+    // keep them at or below 1 wherever a level is available
+    const SincTable& getSincTable(double increment)
+    {
+        static const SincTables sincTables;
+        int band = 0;
+
+        while (band < numSincBands - 1 && increment > sincBandIncrements[band])
+            ++band;
+
+        return *sincTables.tables[static_cast<size_t>(band)];
+    }
+
+    struct SincKernel
+    {
+        static constexpr int preRoll = sincTaps / 2 - 1;
+        static constexpr int postRoll = sincTaps / 2;
+
+        explicit SincKernel(const SincTable& tableToUse) noexcept : table(tableToUse) {}
+
+        template <typename Reader>
+        void gather(Reader&& read, int index, float frac, int lane) noexcept
+        {
+            const auto* row = table.coefficients[static_cast<int>(frac * sincPhases + 0.5f)];
+
+            for (int k = 0; k < sincTaps; ++k)
+            {
+                x[k][lane] = read(index - preRoll + k);
+                c[k][lane] = row[k];
+            }
+        }
+
+        Vec compute() const noexcept
+        {
+            auto sum = Vec::fromRawArray(x[0]) * Vec::fromRawArray(c[0]);
+
+            for (int k = 1; k < sincTaps; ++k)
+                sum += Vec::fromRawArray(x[k]) * Vec::fromRawArray(c[k]);
+
+            return sum;
+        }
+
+        const SincTable& table;
+        alignas(Vec::SIMDNumBytes) float x[sincTaps][lanes] {};
+        alignas(Vec::SIMDNumBytes) float c[sincTaps][lanes] {};
+    };
+
+    //==============================================================================
+    template <typename Kernel>
+    void processWithKernel(Kernel& kernel, const float* source, int sourceLength,
+                           double position, double increment, float startGain, float endGain,
+                           float* dest, int numSamples) noexcept
+    {
+        const float gainStep = (endGain - startGain) / static_cast<float>(numSamples);
+
+        const auto readDirect = [source] (int i) noexcept { return source[i]; };
+        const auto readClamped = [source, last = sourceLength - 1] (int i) noexcept
+        {
+            return source[juce::jlimit(0, last, i)];
+        };
+
+        alignas(Vec::SIMDNumBytes) float result[lanes];
+        alignas(Vec::SIMDNumBytes) float gainRamp[lanes];
+
+        for (int lane = 0; lane < lanes; ++lane)
+            gainRamp[lane] = startGain + static_cast<float>(lane) * gainStep;
+
+        const auto rampPerGroup = Vec::expand(static_cast<float>(lanes) * gainStep);
+        auto gains = Vec::fromRawArray(gainRamp);
+
+        for (int start = 0; start < numSamples; start += lanes)
+        {
+            const int count = juce::jmin(lanes, numSamples - start);
+            const double groupStart = position + start * increment;
+            const int firstIndex = static_cast<int>(std::floor(groupStart));
+            const int lastIndex = static_cast<int>(std::floor(groupStart + (count - 1) * increment));
+
+            // Only groups touching the edges of the source pay for clamping
+            const bool interior = firstIndex - Kernel::preRoll >= 0
+                               && lastIndex + Kernel::postRoll < sourceLength;
+
+            for (int lane = 0; lane < lanes; ++lane)
+            {
+                const double pos = groupStart + juce::jmin(lane, count - 1) * increment;
+                const int index = static_cast<int>(std::floor(pos));
+                const float frac = static_cast<float>(pos - index);
+
+                if (interior)
+                    kernel.gather(readDirect, index, frac, lane);
+                else
+                    kernel.gather(readClamped, index, frac, lane);
+            }
+
+            (kernel.compute() * gains).copyToRawArray(result);
+            gains += rampPerGroup;
+
+            for (int i = 0; i < count; ++i)
+                dest[start + i] += result[i];
+        }
+    }
+}
+
+//==============================================================================
+void VoiceInterpolator::prepare()
+{
+    getSincTable(1.0);
+}
+
+void VoiceInterpolator::process(Mode mode, const float* source, int sourceLength,
+                                double position, double increment, float startGain, float endGain,
+                                float* dest, int numSamples) noexcept
+{
+    if (source == nullptr || sourceLength <= 0 || numSamples <= 0)
+        return;
+
+    switch (mode)
+    {
+        case Mode::linear:
+        {
+            LinearKernel kernel;
+            processWithKernel(kernel, source, sourceLength, position, increment, startGain, endGain, dest, numSamples);
+            break;
+        }
+
+        case Mode::hermite:
+        {
+            HermiteKernel kernel;
+            processWithKernel(kernel, source, sourceLength, position, increment, startGain, endGain, dest, numSamples);
+            break;
+        }
+
+        case Mode::sinc:
+        {
+            SincKernel kernel(getSincTable(std::abs(increment)));
+            processWithKernel(kernel, source, sourceLength, position, increment, startGain, endGain, dest, numSamples);
+            break;
+        }
+    }
+}
+
+void VoiceInterpolator::process(Mode mode, const StemStorage& source, int channel,
+                                double position, double increment, float startGain, float endGain,
+                                float* dest, int numSamples) noexcept
+{
+    if (const auto* samples = source.getFloatPointer(channel))
+    {
+        process(mode, samples, source.getNumSamples(), position, increment, startGain, endGain, dest, numSamples);
+        return;
+    }
+
+    if (source.getNumSamples() <= 0 || numSamples <= 0)
+        return;
+
+    // Enough room either side of a window for the widest kernel
+    constexpr int margin = sincTaps;
+    constexpr int windowSize = 1024;
+    alignas(Vec::SIMDNumBytes) float window[windowSize];
+
+    const float gainStep = (endGain - startGain) / static_cast<float>(numSamples);
+    const int outputsPerWindow = juce::jmax(1, static_cast<int>((windowSize - 2 * margin - 2) / juce::jmax(increment, 1.0e-6)));
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int count = juce::jmin(outputsPerWindow, numSamples - done);
+        const double start = position + done * increment;
+        const int first = static_cast<int>(std::floor(start)) - margin;
+        const int length = static_cast<int>(std::floor(start + (count - 1) * increment)) + margin + 1 - first;
+        jassert(length <= windowSize);
+
+        // Out-of-range reads were clamped by decode(), so the window's own
+        // clamping never changes a result
+        source.decode(channel, first, length, window);
+
+        process(mode, window, length, start - first, increment,
+                startGain + static_cast<float>(done) * gainStep,
+                startGain + static_cast<float>(done + count) * gainStep,
+                dest + done, count);
+
+        done += count;
+    }
+}
+
+const char* VoiceInterpolator::getModeName(Mode mode) noexcept
+{
+    switch (mode)
+    {
+        case Mode::linear:  return "linear";
+        case Mode::hermite: return "hermite";
+        case Mode::sinc:    return "sinc";
+    }
+
+    return "";
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "StemStorage.h"
+
+// Interpolating reader for pitched sample playback. process() adds
+// gain_i * source[position + i * increment] to dest for every output sample,
+// with the gain ramping linearly from startGain towards endGain, computing
+// juce::dsp::SIMDRegister<float>::size() outputs per iteration.
+//
+// Reads outside [0, sourceLength) are clamped to the first/last sample, so
+// callers may pass positions right up to the edges of the source.
+class VoiceInterpolator
+{
+public:
+    enum class Mode
+    {
+        linear,     // 2 points, cheapest
+        hermite,    // 4-point, 3rd-order Hermite
+        sinc        // 8-tap Blackman-windowed sinc, polyphase table per increment band
+    };
+
+    // Builds the sinc coefficient tables; call off the audio thread before
+    // the first process() with Mode::sinc
+    static void prepare();
+
+    static void process(Mode mode, const float* source, int sourceLength,
+                        double position, double increment, float startGain, float endGain,
+                        float* dest, int numSamples) noexcept;
+
+    // Same, reading one channel of a stem in any storage format. Compact
+    // formats are decoded a window at a time into a stack buffer first.
+    static void process(Mode mode, const StemStorage& source, int channel,
+                        double position, double increment, float startGain, float endGain,
+                        float* dest, int numSamples) noexcept;
+
+    static const char* getModeName(Mode mode) noexcept;
+};
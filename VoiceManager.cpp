@@ -0,0 +1,188 @@
+#include "VoiceManager.h"
+
+VoiceManager::VoiceManager()
+{
+    reset();
+}
+
+void VoiceManager::setPolyphony(int numVoices)
+{
+    polyphony = juce::jlimit(1, maxPolyphony, numVoices);
+}
+
+void VoiceManager::setFadeLength(int numSamples) noexcept
+{
+    fadeStep = 1.0f / static_cast<float>(juce::jmax(1, numSamples));
+}
+
+void VoiceManager::reset() noexcept
+{
+    numFree = 0;
+
+    // Lowest indices on top, so small voice counts stay in a few cache lines
+    for (int i = static_cast<int>(voices.size()); --i >= 0;)
+    {
+        voices[static_cast<size_t>(i)] = Voice();
+        freeStack[static_cast<size_t>(numFree++)] = i;
+    }
+
+    noteHeads.fill(-1);
+    noteTails.fill(-1);
+    activeHead = activeTail = -1;
+    numActive = numPlaying = 0;
+}
+
+//==============================================================================
+VoiceManager::Voice& VoiceManager::startVoice(int midiNote) noexcept
+{
+    midiNote = juce::jlimit(0, 127, midiNote);
+
+    while (numPlaying >= polyphony)
+    {
+        if (auto* victim = chooseVictim(midiNote))
+            beginFade(*victim);
+        else
+            break;
+    }
+
+    // Every fade slot is busy: cut the oldest fade short
+    if (numFree == 0)
+    {
+        for (int i = activeHead; i >= 0; i = voices[static_cast<size_t>(i)].next)
+        {
+            if (voices[static_cast<size_t>(i)].isFading())
+            {
+                freeVoice(voices[static_cast<size_t>(i)]);
+                break;
+            }
+        }
+    }
+
+    jassert(numFree > 0);
+    const int index = freeStack[static_cast<size_t>(--numFree)];
+    auto& voice = voices[static_cast<size_t>(index)];
+
+    voice = Voice();
+    voice.midiNote = midiNote;
+    voice.isActive = true;
+
+    // Append to the start-order list
+    voice.prev = activeTail;
+
+    if (activeTail >= 0)
+        voices[static_cast<size_t>(activeTail)].next = index;
+    else
+        activeHead = index;
+
+    activeTail = index;
+
+    // ... and to the note's list
+    voice.notePrev = noteTails[static_cast<size_t>(midiNote)];
+
+    if (voice.notePrev >= 0)
+        voices[static_cast<size_t>(voice.notePrev)].noteNext = index;
+    else
+        noteHeads[static_cast<size_t>(midiNote)] = index;
+
+    noteTails[static_cast<size_t>(midiNote)] = index;
+
+    ++numActive;
+    ++numPlaying;
+    return voice;
+}
+
+void VoiceManager::releaseNote(int midiNote) noexcept
+{
+    if (midiNote < 0 || midiNote > 127)
+        return;
+
+    while (noteHeads[static_cast<size_t>(midiNote)] >= 0)
+        beginFade(voices[static_cast<size_t>(noteHeads[static_cast<size_t>(midiNote)])]);
+}
+
+void VoiceManager::releaseAll() noexcept
+{
+    for (int note = 0; note < 128; ++note)
+        releaseNote(note);
+}
+
+void VoiceManager::freeVoice(Voice& voice) noexcept
+{
+    if (!voice.isActive)
+        return;
+
+    if (!voice.isFading())
+    {
+        unlinkFromNote(voice);
+        --numPlaying;
+    }
+
+    if (voice.prev >= 0)
+        voices[static_cast<size_t>(voice.prev)].next = voice.next;
+    else
+        activeHead = voice.next;
+
+    if (voice.next >= 0)
+        voices[static_cast<size_t>(voice.next)].prev = voice.prev;
+    else
+        activeTail = voice.prev;
+
+    voice.isActive = false;
+    voice.prev = voice.next = -1;
+    --numActive;
+
+    freeStack[static_cast<size_t>(numFree++)] = indexOf(voice);
+}
+
+//==============================================================================
+void VoiceManager::beginFade(Voice& voice) noexcept
+{
+    if (!voice.isActive || voice.isFading())
+        return;
+
+    // A fading voice no longer belongs to its note or counts towards the polyphony
+    unlinkFromNote(voice);
+    voice.fadeStep = fadeStep;
+    --numPlaying;
+}
+
+VoiceManager::Voice* VoiceManager::chooseVictim(int midiNote) noexcept
+{
+    if (stealPolicy == StealPolicy::sameNote && noteHeads[static_cast<size_t>(midiNote)] >= 0)
+        return &voices[static_cast<size_t>(noteHeads[static_cast<size_t>(midiNote)])];
+
+    Voice* victim = nullptr;
+
+    for (int i = activeHead; i >= 0; i = voices[static_cast<size_t>(i)].next)
+    {
+        auto& voice = voices[static_cast<size_t>(i)];
+
+        if (voice.isFading())
+            continue;
+
+        if (stealPolicy != StealPolicy::quietest)
+            return &voice;
+
+        if (victim == nullptr || voice.velocity < victim->velocity)
+            victim = &voice;
+    }
+
+    return victim;
+}
+
+void VoiceManager::unlinkFromNote(Voice& voice) noexcept
+{
+    const auto note = static_cast<size_t>(voice.midiNote);
+
+    if (voice.notePrev >= 0)
+        voices[static_cast<size_t>(voice.notePrev)].noteNext = voice.noteNext;
+    else
+        noteHeads[note] = voice.noteNext;
+
+    if (voice.noteNext >= 0)
+        voices[static_cast<size_t>(voice.noteNext)].notePrev = voice.notePrev;
+    else
+        noteTails[note] = voice.notePrev;
+
+    voice.notePrev = voice.noteNext = -1;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Voice allocation for the sampler. All voices live in one fixed array; free
+// voices sit on a stack and sounding voices on an intrusive list in start
+// order, with a second list per MIDI note, so starting, releasing and
+// iterating voices never scans the whole pool or allocates.
+//
+// When the polyphony is used up a playing voice is stolen: it fades out over
+// a few milliseconds in one of the spare fade slots while the new note starts.
+class VoiceManager
+{
+public:
+    static constexpr int maxPolyphony = 256;
+    static constexpr int numFadeSlots = 32;
+
+    enum class StealPolicy
+    {
+        oldest,     // the voice that started first
+        quietest,   // the lowest velocity
+        sameNote    // the oldest voice of the incoming note, else the oldest
+    };
+
+    struct Voice
+    {
+        int sampleIndex = -1;
+        int midiNote = -1;
+        double position = 0.0;
+        float velocity = 0.0f;
+        float currentPitch = 1.0f;
+
+        // Declick fade after a note-off or steal; fadeStep is 0 while playing
+        float fadeGain = 1.0f;
+        float fadeStep = 0.0f;
+
+        bool isFading() const noexcept { return fadeStep > 0.0f; }
+
+    private:
+        friend class VoiceManager;
+
+        bool isActive = false;
+        int prev = -1, next = -1;           // start-order list
+        int notePrev = -1, noteNext = -1;   // per-note list
+    };
+
+    VoiceManager();
+
+    // Up to maxPolyphony; voices over a lowered limit are stolen by the next note-ons
+    void setPolyphony(int numVoices);
+    int getPolyphony() const noexcept { return polyphony; }
+
+    void setStealPolicy(StealPolicy policy) noexcept { stealPolicy = policy; }
+    void setFadeLength(int numSamples) noexcept;
+
+    // Returns a voice for the note, stealing if needed. Its playback fields are
+    // for the caller to fill in.
+    Voice& startVoice(int midiNote) noexcept;
+
+    // Fades out the voices owned by the note / all voices
+    void releaseNote(int midiNote) noexcept;
+    void releaseAll() noexcept;
+
+    // Returns a voice to the free list at once, e.g. when its sample ended
+    void freeVoice(Voice& voice) noexcept;
+    void reset() noexcept;
+
+    int getNumActiveVoices() const noexcept { return numActive; }
+
+    // Calls fn(Voice&) for every sounding voice, oldest first. fn may free the voice it is given.
+    template <typename Function>
+    void forEachActiveVoice(Function&& fn)
+    {
+        for (int i = activeHead; i >= 0;)
+        {
+            auto& voice = voices[static_cast<size_t>(i)];
+            i = voice.next;
+            fn(voice);
+        }
+    }
+
+private:
+    int indexOf(const Voice& voice) const noexcept { return static_cast<int>(&voice - voices.data()); }
+
+    void beginFade(Voice& voice) noexcept;
+    Voice* chooseVictim(int midiNote) noexcept;
+    void unlinkFromNote(Voice& voice) noexcept;
+
+    std::array<Voice, maxPolyphony + numFadeSlots> voices;
+    std::array<int, maxPolyphony + numFadeSlots> freeStack {};
+    int numFree = 0;
+
+    int activeHead = -1, activeTail = -1;
+    std::array<int, 128> noteHeads, noteTails;
+
+    int polyphony = 16;
+    int numActive = 0;
+    int numPlaying = 0; // active and not fading
+    StealPolicy stealPolicy = StealPolicy::oldest;
+    float fadeStep = 1.0f / 256.0f;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VoiceManager)
+};